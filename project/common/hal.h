@@ -0,0 +1,270 @@
+#ifndef _HAL_H
+#define _HAL_H
+
+#include <stdint.h>
+
+/*
+ * Hardware abstraction of the peripherals the alarm logic uses: GPIO, TWI,
+ * UART, timer and EEPROM. The Mega state machine and the UNO frame parser
+ * only talk to these, so the same sources build for the boards and for a
+ * Linux host.
+ *
+ * AVR backend: GPIO, EEPROM and flash access are inline below and fold into
+ * the same sbi / cbi / lds / sts as direct register access. TWI, UART and
+ * the timer are in hal.c of each board, the Mega is the TWI master and owns
+ * the timer, the UNO is the TWI slave.
+ *
+ * Host backend: project/host/hal_host.c keeps the peripherals in memory and
+ * runs them on a simulated clock, see hal_host.h.
+ */
+
+// Ports, HAL_PIN(H, 3) is PH3
+#define HAL_PORT_A 0
+#define HAL_PORT_B 1
+#define HAL_PORT_C 2
+#define HAL_PORT_D 3
+#define HAL_PORT_E 4
+#define HAL_PORT_F 5
+#define HAL_PORT_G 6
+#define HAL_PORT_H 7
+#define HAL_PORT_J 8
+#define HAL_PORT_K 9
+#define HAL_PORT_L 10
+#define HAL_PORTS 11
+
+#define HAL_PIN(port, bit) ((HAL_PORT_##port << 3) | (bit))
+#define HAL_PIN_PORT(pin) ((pin) >> 3)
+#define HAL_PIN_MASK(pin) (1 << ((pin) & 7))
+
+typedef uint8_t hal_pin_t;
+
+// Functions timed by the benchmark (project/host, make bench) stay out of
+// line in bench builds, so they have a symbol even if called only once
+#ifdef HAL_BENCH
+#define HAL_MEASURED __attribute__((noinline))
+#else
+#define HAL_MEASURED
+#endif
+
+/*
+ * I2C / TWI master initialization with 400 kHz clock.
+ *
+ * @param None
+ * @returns void
+ */
+void hal_twi_master_init();
+
+/*
+ * I2C / TWI transmission from master to slave.
+ *
+ * @param uint8_t address slave address byte, R/W bit included
+ * @param uint8_t *data bytes to send, binary
+ * @param uint8_t len number of bytes
+ *
+ * @returns uint8_t 0 for success, 1 if the frame did not get through, the
+ * bus is given up again
+ */
+uint8_t hal_twi_write(uint8_t address, const uint8_t *data, uint8_t len);
+
+/*
+ * Setup the device as TWI slave receiver. An address match wakes the CPU
+ * from sleep, the bus is held until the frame is read.
+ *
+ * @param uint8_t address own address byte
+ * @returns void
+ */
+void hal_twi_slave_init(uint8_t address);
+
+/*
+ * Check for a frame from the master waiting to be read.
+ *
+ * @param None
+ * @returns uint8_t non zero if hal_twi_read() has a frame
+ */
+uint8_t hal_twi_pending();
+
+/*
+ * Receive one frame from the master. Frames are binary, the end is the
+ * STOP condition or a full buffer, the byte that fills it is not
+ * acknowledged. A frame cut short by a bus error or timeout is dropped.
+ *
+ * @param uint8_t *dest buffer, zeroed first
+ * @param uint8_t size size of dest
+ *
+ * @returns uint8_t number of bytes received
+ */
+uint8_t hal_twi_read(uint8_t *dest, uint8_t size);
+
+/*
+ * Wake up again on the next address match, after the frame is handled.
+ *
+ * @param None
+ * @returns void
+ */
+void hal_twi_listen();
+
+/*
+ * Initialize the debug UART and point stdin and stdout to it.
+ *
+ * @param uint16_t ubrr baud rate register value, F_CPU / 16 / BAUD - 1
+ * @returns void
+ */
+void hal_uart_init(uint16_t ubrr);
+
+/*
+ * Start the periodic timer, HAL_TIMER_ISR() runs every period. Enables
+ * interrupts.
+ *
+ * @param uint16_t period_ms period 1 - 4194 ms
+ * @returns void
+ */
+void hal_timer_start_ms(uint16_t period_ms);
+
+/*
+ * Stop the periodic timer.
+ *
+ * @param None
+ * @returns void
+ */
+void hal_timer_stop();
+
+#ifdef __AVR__
+
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#define HAL_INLINE static inline __attribute__((always_inline))
+
+// Handler of the periodic timer, the Mega runs it on timer 3
+#define HAL_TIMER_ISR() ISR(TIMER3_COMPA_vect)
+
+// Block not interrupted by any ISR, interrupt state restored after it
+#define HAL_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+
+#define hal_irq_disable() cli()
+#define hal_irq_enable() sei()
+
+/*
+ * PINx of a pin, DDRx and PORTx follow it on every port of both MCUs.
+ * Constant pins fold to the register address.
+ */
+HAL_INLINE volatile uint8_t *hal_gpio_reg(hal_pin_t pin)
+{
+    switch (HAL_PIN_PORT(pin)) {
+#ifdef PINA
+    case HAL_PORT_A:
+        return &PINA;
+#endif
+    case HAL_PORT_B:
+        return &PINB;
+    case HAL_PORT_C:
+        return &PINC;
+    case HAL_PORT_D:
+        return &PIND;
+#ifdef PINE
+    case HAL_PORT_E:
+        return &PINE;
+    case HAL_PORT_F:
+        return &PINF;
+    case HAL_PORT_G:
+        return &PING;
+    case HAL_PORT_H:
+        return &PINH;
+    case HAL_PORT_J:
+        return &PINJ;
+    case HAL_PORT_K:
+        return &PINK;
+    case HAL_PORT_L:
+        return &PINL;
+#endif
+    }
+    // Port the MCU does not have
+    return &PINB;
+}
+
+/*
+ * Pin direction, output or input.
+ *
+ * @param hal_pin_t pin HAL_PIN() of the pin
+ * @returns void
+ */
+HAL_INLINE void hal_gpio_output(hal_pin_t pin)
+{
+    hal_gpio_reg(pin)[1] |= HAL_PIN_MASK(pin);
+}
+
+HAL_INLINE void hal_gpio_input(hal_pin_t pin)
+{
+    hal_gpio_reg(pin)[1] &= ~HAL_PIN_MASK(pin);
+}
+
+/*
+ * Drive an output pin.
+ *
+ * @param hal_pin_t pin HAL_PIN() of the pin
+ * @param uint8_t level 0 low, otherwise high
+ * @returns void
+ */
+HAL_INLINE void hal_gpio_write(hal_pin_t pin, uint8_t level)
+{
+    if (level) {
+        hal_gpio_reg(pin)[2] |= HAL_PIN_MASK(pin);
+    }
+    else {
+        hal_gpio_reg(pin)[2] &= ~HAL_PIN_MASK(pin);
+    }
+}
+
+/*
+ * Read the level of a pin.
+ *
+ * @param hal_pin_t pin HAL_PIN() of the pin
+ * @returns uint8_t 1 high, 0 low
+ */
+HAL_INLINE uint8_t hal_gpio_read(hal_pin_t pin)
+{
+    return 0 != (hal_gpio_reg(pin)[0] & HAL_PIN_MASK(pin));
+}
+
+/*
+ * Read one byte of EEPROM, erased bytes read 0xFF.
+ *
+ * @param uint8_t *addr EEPROM address
+ * @returns uint8_t the byte
+ */
+HAL_INLINE uint8_t hal_eeprom_read(const uint8_t *addr)
+{
+    return eeprom_read_byte(addr);
+}
+
+#else // Host backend, project/host/hal_host.c
+
+#include <stddef.h>
+
+// Flash is plain memory
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+
+// Called by the simulated clock
+#define HAL_TIMER_ISR() void hal_timer_isr(void)
+
+// Interrupts only run while the host sleeps, see hal_host_sleep()
+#define HAL_ATOMIC for (uint8_t hal_once = 1; hal_once; hal_once = 0)
+
+#define hal_irq_disable()
+#define hal_irq_enable()
+
+void hal_gpio_output(hal_pin_t pin);
+void hal_gpio_input(hal_pin_t pin);
+void hal_gpio_write(hal_pin_t pin, uint8_t level);
+uint8_t hal_gpio_read(hal_pin_t pin);
+uint8_t hal_eeprom_read(const uint8_t *addr);
+
+#endif // __AVR__
+
+#endif // _HAL_H
@@ -0,0 +1,40 @@
+#include "log.h"
+
+// Libs
+#include <avr/io.h>
+
+/*
+ * Send one byte, binary, no newline translation.
+ */
+static void log_put(uint8_t byte)
+{
+    while (!(UCSR0A & (1 << UDRE0))) {
+        ;
+    }
+    UDR0 = byte;
+}
+
+/*
+ * Send a log record over UART.
+ *
+ * @param uint16_t id format string ID, see LOG_ID()
+ * @param void *args argument bytes
+ * @param uint8_t len number of argument bytes
+ * @returns void
+ */
+void log_write(uint16_t id, const void *args, uint8_t len)
+{
+    const uint8_t *byte = args;
+
+    log_put(LOG_MARK);
+    log_put((uint8_t)id);
+    log_put((uint8_t)(id >> 8));
+    log_put(len);
+    while (len--) {
+        log_put(*byte++);
+    }
+}
+
+/*
+ EOF
+ */
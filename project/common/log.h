@@ -0,0 +1,110 @@
+#ifndef _LOG_H
+#define _LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Deferred logging. LOG(format, ...) takes the arguments of printf, but the
+ * format string goes into the .logstr section of the ELF image, which is
+ * not loaded into flash. Only its offset in that section (the ID) and the
+ * raw argument bytes are sent over UART:
+ *
+ *   <LOG_MARK> <ID, 2 bytes> <length> <arguments>
+ *
+ * little endian, each argument as it is passed to printf (char and int 2
+ * bytes, long 4). host/log_decode reads the formats from the ELF image and
+ * prints the text. Bytes outside log records pass through, so plain text
+ * still reads fine.
+ *
+ * Up to 4 integer arguments: %d %i %u %x %X %c and their l versions. There
+ * is no %s, strings would have to be copied. LOG blocks until the record
+ * is sent, use TRACE() of trace.h from interrupts.
+ *
+ * On the host LOG is printf. Boards built with DEFS=-DLOG_PRINTF use
+ * printf as well, so make budget of both builds shows the flash the tokens
+ * save.
+ */
+
+// Start of a record, ASCII record separator
+#define LOG_MARK 0x1E
+
+#if defined(__AVR__) && !defined(LOG_PRINTF)
+
+// Section without flags, the ";" comments out the "a" (allocated) flags
+// GCC appends, so the linker keeps the section out of the image
+#define LOG_SECTION ".logstr,\"\",@progbits;"
+
+// ID of a format string, its offset in .logstr
+#define LOG_ID(format)                                                       \
+    ({                                                                       \
+        static const char log_format[]                                       \
+            __attribute__((section(LOG_SECTION), used)) = format;            \
+        (uint16_t)(uintptr_t)log_format;                                     \
+    })
+
+// Arguments as printf gets them, char promoted to int
+#define LOG_ARG(name, value) __typeof__(+(value)) name
+
+#define LOG_0(format) log_write(LOG_ID(format), 0, 0)
+
+#define LOG_1(format, a)                                                     \
+    do {                                                                     \
+        struct __attribute__((packed)) {                                     \
+            LOG_ARG(a0, a);                                                  \
+        } log_args = {(a)};                                                  \
+        log_write(LOG_ID(format), &log_args, sizeof(log_args));              \
+    } while (0)
+
+#define LOG_2(format, a, b)                                                  \
+    do {                                                                     \
+        struct __attribute__((packed)) {                                     \
+            LOG_ARG(a0, a);                                                  \
+            LOG_ARG(a1, b);                                                  \
+        } log_args = {(a), (b)};                                             \
+        log_write(LOG_ID(format), &log_args, sizeof(log_args));              \
+    } while (0)
+
+#define LOG_3(format, a, b, c)                                               \
+    do {                                                                     \
+        struct __attribute__((packed)) {                                     \
+            LOG_ARG(a0, a);                                                  \
+            LOG_ARG(a1, b);                                                  \
+            LOG_ARG(a2, c);                                                  \
+        } log_args = {(a), (b), (c)};                                        \
+        log_write(LOG_ID(format), &log_args, sizeof(log_args));              \
+    } while (0)
+
+#define LOG_4(format, a, b, c, d)                                            \
+    do {                                                                     \
+        struct __attribute__((packed)) {                                     \
+            LOG_ARG(a0, a);                                                  \
+            LOG_ARG(a1, b);                                                  \
+            LOG_ARG(a2, c);                                                  \
+            LOG_ARG(a3, d);                                                  \
+        } log_args = {(a), (b), (c), (d)};                                   \
+        log_write(LOG_ID(format), &log_args, sizeof(log_args));              \
+    } while (0)
+
+// LOG_0 - LOG_4 by the number of arguments after the format
+#define LOG_PICK(_0, _1, _2, _3, _4, name, ...) name
+#define LOG(...)                                                             \
+    LOG_PICK(__VA_ARGS__, LOG_4, LOG_3, LOG_2, LOG_1, LOG_0, _)(__VA_ARGS__)
+
+/*
+ * Send a log record over UART.
+ *
+ * @param uint16_t id format string ID, see LOG_ID()
+ * @param void *args argument bytes
+ * @param uint8_t len number of argument bytes
+ * @returns void
+ */
+void log_write(uint16_t id, const void *args, uint8_t len);
+
+#else
+
+#define LOG(...) printf(__VA_ARGS__)
+
+#endif // __AVR__ && !LOG_PRINTF
+
+#endif // _LOG_H
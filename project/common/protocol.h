@@ -0,0 +1,40 @@
+#ifndef _PROTOCOL_H
+#define _PROTOCOL_H
+
+/*
+ * Display frames sent by the Mega to the UNO over TWI, shared by both.
+ *
+ *   [ screen ID ] [ type ] [ value ] [ type ] [ value ] ...
+ *
+ * The UNO renders the screen from its own templates in flash, parameters
+ * fill the template slots in order. Frames are binary, the end is the TWI
+ * STOP condition and not a NUL byte.
+ */
+
+// Frame size limit, slave receive buffer
+#define FRAME_SIZE 16
+
+// Screen IDs, 0 is never sent
+#define SCREEN_WELCOME 1
+#define SCREEN_MOVEMENT 2  // movement sensed, countdown starting
+#define SCREEN_COUNTDOWN 3 // seconds remaining, seconds total
+#define SCREEN_CORRECT 4   // digits
+#define SCREEN_WRONG 5     // digits
+#define SCREEN_TIME_UP 6
+#define SCREEN_ARMED 7
+#define SCREEN_ERROR 8 // error code
+#define SCREEN_USER 9  // user ID
+#define SCREEN_KEYS 10 // keys entered, drawn over the current screen
+#define SCREEN_COUNT 11
+
+// Parameter types and their values
+#define PARAM_DIGITS 1  // digit count, then packed BCD, high nibble first
+#define PARAM_SECONDS 2 // one byte
+#define PARAM_USER 3    // one byte
+#define PARAM_ERROR 4   // one byte
+#define PARAM_KEYS 5    // one byte, number of keys entered
+
+// Digits one frame can carry: ID, type and count bytes, the rest is BCD
+#define PARAM_DIGITS_MAX ((FRAME_SIZE - 3) * 2)
+
+#endif // _PROTOCOL_H
@@ -0,0 +1,67 @@
+#include "stack.h"
+
+#include "log.h"
+
+// Libs
+#include <avr/io.h>
+
+// End of .bss/.noinit, from the linker script
+extern uint8_t __heap_start;
+
+// Runs before the C runtime sets up anything, no stack frame and no calls
+void stack_paint() __attribute__((naked, used, section(".init1")));
+
+/*
+ * Paint the free RAM up to SP, RAMEND at reset.
+ */
+void stack_paint()
+{
+    uint8_t *p = &__heap_start;
+
+    while (p < (uint8_t *)SP) {
+        *p++ = STACK_PAINT;
+    }
+}
+
+/*
+ * Bytes between __heap_start and the deepest stack use so far.
+ *
+ * @param None
+ * @returns uint16_t bytes never touched by the stack
+ */
+uint16_t stack_unused()
+{
+    const uint8_t *p = &__heap_start;
+
+    while ((p <= (const uint8_t *)RAMEND) && (STACK_PAINT == *p)) {
+        p++;
+    }
+    return (uint16_t)(p - &__heap_start);
+}
+
+/*
+ * Deepest stack use so far, from the top of RAM.
+ *
+ * @param None
+ * @returns uint16_t bytes
+ */
+uint16_t stack_max_used()
+{
+    return (uint16_t)((const uint8_t *)RAMEND - &__heap_start + 1) -
+           stack_unused();
+}
+
+/*
+ * Print the deepest stack use and the headroom left over UART.
+ *
+ * @param None
+ * @returns Void
+ */
+void stack_report()
+{
+    LOG("stack: max %u bytes, %u free\n", stack_max_used(), stack_unused());
+}
+
+/*
+ EOF
+ */
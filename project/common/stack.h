@@ -0,0 +1,42 @@
+#ifndef _STACK_H
+#define _STACK_H
+
+#include <stdint.h>
+
+/*
+ * Stack high-water mark of both boards. The free RAM between the end of
+ * .bss/.noinit (__heap_start, there is no heap) and SP is painted with
+ * STACK_PAINT in .init1, before anything runs. The stack grows down into
+ * it, paint still intact at the bottom was never used.
+ *
+ * The simulator reads the same paint, see host/cosim.c.
+ */
+
+// Paint byte, unlikely to be a pushed register or return address
+#define STACK_PAINT 0xC5
+
+/*
+ * Bytes between __heap_start and the deepest stack use so far.
+ *
+ * @param None
+ * @returns uint16_t bytes never touched by the stack
+ */
+uint16_t stack_unused();
+
+/*
+ * Deepest stack use so far, from the top of RAM.
+ *
+ * @param None
+ * @returns uint16_t bytes
+ */
+uint16_t stack_max_used();
+
+/*
+ * Print the deepest stack use and the headroom left over UART.
+ *
+ * @param None
+ * @returns Void
+ */
+void stack_report();
+
+#endif // _STACK_H
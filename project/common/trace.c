@@ -0,0 +1,143 @@
+#include "trace.h"
+
+#if TRACE_SIZE
+
+// Libs
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+trace_record_t g_trace[TRACE_SIZE];
+volatile uint8_t g_trace_head = 0;
+volatile uint16_t g_trace_total = 0;
+
+// Running sum of the dump
+static uint8_t g_trace_sum = 0;
+
+// RXD is PE0 / PCINT8 on the Mega, PD0 / PCINT16 on the UNO. The interrupt
+// only wakes the CPU, the byte is read by trace_poll().
+#if defined(__AVR_ATmega2560__)
+#define TRACE_RXD_PCIE PCIE1
+#define TRACE_RXD_PCMSK PCMSK1
+#define TRACE_RXD_PCINT PCINT8
+EMPTY_INTERRUPT(PCINT1_vect);
+#else
+#define TRACE_RXD_PCIE PCIE2
+#define TRACE_RXD_PCMSK PCMSK2
+#define TRACE_RXD_PCINT PCINT16
+EMPTY_INTERRUPT(PCINT2_vect);
+#endif
+
+/*
+ * Send one byte over UART, binary, no newline translation.
+ */
+static void trace_tx(uint8_t byte)
+{
+    while (!(UCSR0A & (1 << UDRE0))) {
+        ;
+    }
+    UDR0 = byte;
+}
+
+/*
+ * Send one byte of the dump, escaped if log_decode could take it for
+ * LOG_MARK.
+ */
+static void trace_put(uint8_t byte)
+{
+    g_trace_sum += byte;
+    if ((LOG_MARK == byte) || (TRACE_ESC == byte)) {
+        trace_tx(TRACE_ESC);
+        byte ^= TRACE_ESC_XOR;
+    }
+    trace_tx(byte);
+}
+
+/*
+ * Wake on the start bit of RXD and record TRACE_BOOT.
+ *
+ * @param None
+ * @returns void
+ */
+void trace_init()
+{
+    TRACE_RXD_PCMSK |= (1 << TRACE_RXD_PCINT);
+    PCICR |= (1 << TRACE_RXD_PCIE);
+    TRACE(TRACE_BOOT, TRACE_BOARD, MCUSR);
+}
+
+/*
+ * Dump request waiting on the UART.
+ *
+ * @param None
+ * @returns uint8_t non zero if trace_poll() has a byte to read
+ */
+uint8_t trace_pending() { return UCSR0A & (1 << RXC0); }
+
+/*
+ * Dump the ring if 'T' was received, other bytes are dropped.
+ *
+ * @param None
+ * @returns void
+ */
+void trace_poll()
+{
+    while (trace_pending()) {
+        if ('T' == UDR0) {
+            trace_dump();
+        }
+    }
+}
+
+/*
+ * Write the ring over UART in the binary dump format, ~5 ms per record at
+ * 9600 baud. Interrupts stay enabled, records written meanwhile may replace
+ * old ones not sent yet.
+ *
+ * @param None
+ * @returns void
+ */
+void trace_dump()
+{
+    uint16_t total;
+    uint8_t count;
+    uint8_t idx;
+
+    HAL_ATOMIC
+    {
+        total = g_trace_total;
+        idx = g_trace_head;
+    }
+    count = (TRACE_SIZE < total) ? TRACE_SIZE : (uint8_t)total;
+    idx = (idx - count) & (TRACE_SIZE - 1);
+
+    g_trace_sum = 0;
+    trace_put('T');
+    trace_put('R');
+    trace_put(TRACE_BOARD);
+    for (uint8_t shift = 0; 32 > shift; shift += 8) {
+        trace_put((uint8_t)(TRACE_TICK_US >> shift));
+    }
+    trace_put(TRACE_TIME_BITS);
+    trace_put((uint8_t)total);
+    trace_put((uint8_t)(total >> 8));
+    trace_put(count);
+
+    while (count--) {
+        trace_record_t record;
+
+        HAL_ATOMIC { record = g_trace[idx]; }
+        trace_put((uint8_t)record.time);
+        trace_put((uint8_t)(record.time >> 8));
+        trace_put(record.id);
+        trace_put(record.arg0);
+        trace_put(record.arg1);
+        idx = (idx + 1) & (TRACE_SIZE - 1);
+    }
+    trace_put(g_trace_sum);
+}
+
+#endif // TRACE_SIZE
+
+/*
+ EOF
+ */
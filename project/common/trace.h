@@ -0,0 +1,180 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+#include "hal.h"
+#include "log.h"
+
+/*
+ * Binary trace of both boards. TRACE() stores a fixed size record (time
+ * stamp, event ID, two argument bytes) in a RAM ring, the oldest records
+ * are overwritten. A record costs a few cycles and no UART time, so it may
+ * be used from interrupts and timing critical code instead of printf.
+ *
+ * The ring is dumped over UART on demand: send 'T' until the dump starts.
+ * The first byte wakes a sleeping board through a pin change on RXD and is
+ * usually lost. Dump, little endian:
+ *
+ *   'T' 'R' <board> <tick us, 4 bytes> <time bits> <total, 2 bytes> <count>
+ *   <records> <sum>
+ *
+ * Time stamps wrap at time bits. total is the number of records ever
+ * written, count the ones that follow oldest first, each <time, 2 bytes>
+ * <id> <arg0> <arg1>. sum is the low byte of the sum of all bytes before
+ * it. Decode with host/trace_decode.
+ *
+ * LOG records share the UART, see log.h. So that log_decode never takes a
+ * dump byte for the start of a record, LOG_MARK and TRACE_ESC are sent as
+ * TRACE_ESC followed by the byte XOR TRACE_ESC_XOR. sum is taken before
+ * escaping.
+ *
+ * Build with DEFS=-DTRACE_SIZE=0 to leave the trace out. The host builds
+ * have no trace. Recording builds of the Mega, see pm/Makefile record,
+ * use DEFS="-DTRACE_CLOCK_MS -DTRACE_SIZE=128".
+ */
+
+#ifndef __AVR__
+#undef TRACE_SIZE
+#define TRACE_SIZE 0
+#endif
+
+// Records in the ring, a power of two up to 128
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 32
+#endif
+
+// Escape of LOG_MARK and itself in the dump, ASCII escape
+#define TRACE_ESC 0x1B
+#define TRACE_ESC_XOR 0x20
+
+// Board IDs of the dump header
+#define TRACE_BOARD_MEGA 1
+#define TRACE_BOARD_UNO 2
+
+// Event IDs and their arguments
+#define TRACE_BOOT 1      // board, reset cause (MCUSR)
+#define TRACE_STATE 2     // Mega state, previous state
+#define TRACE_KEY 3       // key, keys entered
+#define TRACE_CODE 4      // 1 correct, keys entered
+#define TRACE_TWI_TX 5    // screen ID, 0 ACK or 1 NACK
+#define TRACE_TWI_RX 6    // screen ID, length
+#define TRACE_TWI_BAD 7   // screen ID, length of a rejected frame
+#define TRACE_SECOND 8    // seconds counted, 0
+#define TRACE_COUNTDOWN 9 // seconds left, 0
+#define TRACE_INPUT 10    // input, level as the Mega samples it
+#define TRACE_EVENTS 11
+
+// Inputs of TRACE_INPUT, pm/main.c
+#define TRACE_INPUT_PIR 1
+#define TRACE_INPUT_REARM 2
+
+typedef struct {
+    uint16_t time;
+    uint8_t id;
+    uint8_t arg0;
+    uint8_t arg1;
+} trace_record_t;
+
+#if TRACE_SIZE
+
+// Time stamp. Timer 5 of the Mega counts awake time in 4 us and wraps every
+// 262 ms, the UNO has no free running timer and uses its 250 ms watchdog
+// tick count. See pm/power.c and pu/power.c.
+//
+// Recording builds of the Mega, DEFS=-DTRACE_CLOCK_MS, stamp ms of wall
+// clock instead, sleep included, so an input timeline can be replayed on
+// the host, see trace_decode -s.
+#if defined(__AVR_ATmega2560__)
+#define TRACE_BOARD TRACE_BOARD_MEGA
+#ifdef TRACE_CLOCK_MS
+uint16_t power_millis();
+#define TRACE_TICK_US 1000UL
+#define TRACE_TIME_BITS 16
+#define TRACE_TIME() power_millis()
+#else
+#define TRACE_TICK_US 4UL
+#define TRACE_TIME_BITS 16
+#define TRACE_TIME() TCNT5
+#endif
+#else
+uint8_t power_ticks();
+#define TRACE_BOARD TRACE_BOARD_UNO
+#define TRACE_TICK_US 250000UL
+#define TRACE_TIME_BITS 8
+#define TRACE_TIME() power_ticks()
+#endif
+
+// Ring and next record to write, see TRACE()
+extern trace_record_t g_trace[TRACE_SIZE];
+extern volatile uint8_t g_trace_head;
+extern volatile uint16_t g_trace_total;
+
+/*
+ * Store a record, safe from interrupts.
+ *
+ * @param uint8_t id event ID
+ * @param uint8_t arg0 first argument
+ * @param uint8_t arg1 second argument
+ * @returns void
+ */
+HAL_INLINE void trace(uint8_t id, uint8_t arg0, uint8_t arg1)
+{
+    HAL_ATOMIC
+    {
+        trace_record_t *record = &g_trace[g_trace_head];
+
+        g_trace_head = (g_trace_head + 1) & (TRACE_SIZE - 1);
+        g_trace_total++;
+        record->time = TRACE_TIME();
+        record->id = id;
+        record->arg0 = arg0;
+        record->arg1 = arg1;
+    }
+}
+
+#define TRACE(id, arg0, arg1) trace((id), (arg0), (arg1))
+
+/*
+ * Wake on the start bit of RXD and record TRACE_BOOT.
+ *
+ * @param None
+ * @returns void
+ */
+void trace_init();
+
+/*
+ * Dump request waiting on the UART.
+ *
+ * @param None
+ * @returns uint8_t non zero if trace_poll() has a byte to read
+ */
+uint8_t trace_pending();
+
+/*
+ * Dump the ring if 'T' was received, other bytes are dropped.
+ *
+ * @param None
+ * @returns void
+ */
+void trace_poll();
+
+/*
+ * Write the ring over UART in the binary dump format.
+ *
+ * @param None
+ * @returns void
+ */
+void trace_dump();
+
+#else
+
+#define TRACE(id, arg0, arg1)
+#define trace_init()
+#define trace_pending() 0
+#define trace_poll()
+#define trace_dump()
+
+#endif // TRACE_SIZE
+
+#endif // _TRACE_H
@@ -0,0 +1,154 @@
+/*
+ * Compare a benchmark run of cosim -b against a recorded baseline.
+ *
+ *   ./bench_check bench_baseline.csv bench.csv [threshold %]
+ *
+ * Both files are board,function,calls,min,avg,max in cycles, lines starting
+ * with '#' are comments (the baseline records its toolchain). A function
+ * fails when its average or worst case grew by more than the threshold
+ * (5 % by default), or when it is missing or was not called in the run.
+ * Functions new in the run are listed but do not fail. Exits 1 on failure.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ROWS 64
+#define NAME_LEN 32
+#define LINE_LEN 160
+
+#define DEFAULT_THRESHOLD 5.0
+
+typedef struct {
+    char board[NAME_LEN];
+    char function[NAME_LEN];
+    unsigned long calls;
+    unsigned long long min;
+    unsigned long long avg;
+    unsigned long long max;
+} bench_row_t;
+
+typedef struct {
+    bench_row_t rows[MAX_ROWS];
+    uint8_t count;
+} bench_t;
+
+/*
+ * Read a benchmark CSV, the header, comments and malformed lines are
+ * skipped.
+ * Returns 0 on success.
+ */
+static int read_csv(const char *path, bench_t *bench)
+{
+    FILE *in = fopen(path, "r");
+    char line[LINE_LEN];
+
+    if (!in) {
+        fprintf(stderr, "bench_check: cannot read %s\n", path);
+        return 1;
+    }
+    bench->count = 0;
+    while (fgets(line, sizeof(line), in) && (MAX_ROWS > bench->count)) {
+        bench_row_t *row = &bench->rows[bench->count];
+
+        if ('#' == line[0]) {
+            continue;
+        }
+        if (6 == sscanf(line, "%31[^,],%31[^,],%lu,%llu,%llu,%llu",
+                        row->board, row->function, &row->calls, &row->min,
+                        &row->avg, &row->max)) {
+            bench->count++;
+        }
+    }
+    fclose(in);
+    return 0;
+}
+
+/*
+ * Row of the same board and function, 0 if there is none.
+ */
+static const bench_row_t *find_row(const bench_t *bench,
+                                   const bench_row_t *key)
+{
+    for (uint8_t idx = 0; bench->count > idx; idx++) {
+        if ((0 == strcmp(bench->rows[idx].board, key->board)) &&
+            (0 == strcmp(bench->rows[idx].function, key->function))) {
+            return &bench->rows[idx];
+        }
+    }
+    return 0;
+}
+
+/*
+ * Change from base to now in percent.
+ */
+static double change(unsigned long long base, unsigned long long now)
+{
+    if (!base) {
+        return now ? 100.0 : 0.0;
+    }
+    return 100.0 * ((double)now - (double)base) / (double)base;
+}
+
+int main(int argc, char **argv)
+{
+    static bench_t baseline;
+    static bench_t current;
+    double threshold = DEFAULT_THRESHOLD;
+    int failures = 0;
+
+    if ((3 > argc) || (4 < argc)) {
+        fprintf(stderr, "usage: %s baseline.csv current.csv [threshold %%]\n",
+                argv[0]);
+        return 2;
+    }
+    if (4 == argc) {
+        threshold = atof(argv[3]);
+    }
+    if (read_csv(argv[1], &baseline) || read_csv(argv[2], &current)) {
+        return 2;
+    }
+
+    printf("%-5s %-18s %10s %10s %7s %10s %10s %7s\n", "board", "function",
+           "base avg", "avg", "%", "base max", "max", "%");
+    for (uint8_t idx = 0; baseline.count > idx; idx++) {
+        const bench_row_t *base = &baseline.rows[idx];
+        const bench_row_t *now = find_row(&current, base);
+        double avg_change;
+        double max_change;
+
+        if (!now || (base->calls && !now->calls)) {
+            printf("FAIL %s %s: %s\n", base->board, base->function,
+                   now ? "not called" : "missing");
+            failures++;
+            continue;
+        }
+
+        avg_change = change(base->avg, now->avg);
+        max_change = change(base->max, now->max);
+        printf("%-5s %-18s %10llu %10llu %+7.1f %10llu %10llu %+7.1f\n",
+               now->board, now->function, base->avg, now->avg, avg_change,
+               base->max, now->max, max_change);
+        if ((threshold < avg_change) || (threshold < max_change)) {
+            printf("FAIL %s %s: more than %.1f %% slower\n", now->board,
+                   now->function, threshold);
+            failures++;
+        }
+    }
+
+    for (uint8_t idx = 0; current.count > idx; idx++) {
+        if (!find_row(&baseline, &current.rows[idx])) {
+            printf("new  %s %s: avg %llu max %llu\n", current.rows[idx].board,
+                   current.rows[idx].function, current.rows[idx].avg,
+                   current.rows[idx].max);
+        }
+    }
+
+    if (failures) {
+        printf("%d regression(s)\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,394 @@
+/*
+ * Flash and RAM use of a firmware build per module and per symbol, checked
+ * against a budget. Run by "make budget" of the boards:
+ *
+ *   ./budget_check main.map main.sym budget.txt [symbols]
+ *
+ * main.map is the linker map (-Wl,-Map), main.sym the output of
+ * "avr-nm -S main.elf". Input sections of the map are attributed to their
+ * object file, archive members such as libc.a(vfprintf_std.o) included:
+ *
+ *   text      code in .text
+ *   progmem   .progmem* input sections, constants in flash
+ *   data      .data and .rodata, RAM with an initial copy in flash
+ *   bss       .bss and .noinit
+ *
+ * Flash is text + progmem + data, RAM is data + bss without the stack.
+ * Symbols (static ones too) take the kind and module of the input section
+ * they are in, the largest ones are listed (20 by default).
+ *
+ * The budget file has "flash <bytes>" and "ram <bytes>" lines and
+ * optionally "<module> flash|ram <bytes>" lines, # starts a comment.
+ * Exits 1 if any limit is exceeded.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SECTIONS 2048
+#define MAX_MODULES 128
+#define MAX_SYMBOLS 2048
+#define NAME_LEN 64
+#define LINE_LEN 512
+
+#define DEFAULT_SYMBOLS 20
+
+typedef enum { KIND_TEXT, KIND_PROGMEM, KIND_DATA, KIND_BSS, KINDS } kind_t;
+
+static const char *const g_kind_names[KINDS] = {"text", "progmem", "data",
+                                                "bss"};
+
+// Input section of the map
+typedef struct {
+    unsigned long addr;
+    unsigned long size;
+    kind_t kind;
+    uint8_t module;
+} section_t;
+
+typedef struct {
+    char name[NAME_LEN];
+    unsigned long size[KINDS];
+} module_t;
+
+typedef struct {
+    char name[NAME_LEN];
+    unsigned long size;
+    kind_t kind;
+    uint8_t module;
+} symbol_t;
+
+static section_t g_sections[MAX_SECTIONS];
+static uint16_t g_section_count = 0;
+static module_t g_modules[MAX_MODULES];
+static uint8_t g_module_count = 0;
+static symbol_t g_symbols[MAX_SYMBOLS];
+static uint16_t g_symbol_count = 0;
+
+/*
+ * Index of a module by the path of its object file, added if new.
+ */
+static uint8_t module_index(const char *path)
+{
+    const char *name = path;
+
+    // Basename, the member of an archive keeps its archive
+    for (const char *c = path; *c && ('(' != *c); c++) {
+        if ('/' == *c) {
+            name = c + 1;
+        }
+    }
+    for (uint8_t idx = 0; g_module_count > idx; idx++) {
+        if (0 == strcmp(g_modules[idx].name, name)) {
+            return idx;
+        }
+    }
+    if (MAX_MODULES <= g_module_count) {
+        return MAX_MODULES - 1;
+    }
+    snprintf(g_modules[g_module_count].name, NAME_LEN, "%s", name);
+    return g_module_count++;
+}
+
+/*
+ * Kind of an input section, KINDS for sections that use neither flash
+ * nor RAM (debug info, EEPROM, ...).
+ */
+static kind_t section_kind(const char *output, const char *input)
+{
+    if (0 == strncmp(input, ".progmem", 8)) {
+        return KIND_PROGMEM;
+    }
+    if (0 == strcmp(output, ".text")) {
+        return KIND_TEXT;
+    }
+    if (0 == strcmp(output, ".data")) {
+        return KIND_DATA;
+    }
+    if ((0 == strcmp(output, ".bss")) || (0 == strcmp(output, ".noinit"))) {
+        return KIND_BSS;
+    }
+    return KINDS;
+}
+
+/*
+ * Add an input section of the map.
+ */
+static void add_section(const char *output, const char *input,
+                        unsigned long addr, unsigned long size,
+                        const char *path)
+{
+    kind_t kind = section_kind(output, input);
+    section_t *section;
+
+    if ((KINDS == kind) || !size || (MAX_SECTIONS <= g_section_count)) {
+        return;
+    }
+    section = &g_sections[g_section_count++];
+    section->addr = addr;
+    section->size = size;
+    section->kind = kind;
+    section->module = module_index(path);
+    g_modules[section->module].size[kind] += size;
+}
+
+/*
+ * Read the memory map part of a GNU ld map file. Returns 0 on success.
+ *
+ * Output sections start in column 0, input sections are indented by one
+ * space: " .text.main 0x... 0x... main.o". Names too long for their column
+ * continue on the next line with the address, size and file.
+ */
+static int read_map(const char *path)
+{
+    FILE *in = fopen(path, "r");
+    char line[LINE_LEN];
+    char output[NAME_LEN] = "";
+    char pending[NAME_LEN] = "";
+    uint8_t in_map = 0;
+
+    if (!in) {
+        fprintf(stderr, "budget_check: cannot read %s\n", path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), in)) {
+        char name[NAME_LEN];
+        char file[LINE_LEN];
+        unsigned long addr;
+        unsigned long size;
+
+        // Discarded input sections come before the map
+        if (!in_map) {
+            in_map = (0 == strncmp(line, "Linker script and memory map", 28));
+            continue;
+        }
+
+        if ('.' == line[0]) {
+            sscanf(line, "%63s", output);
+            pending[0] = '\0';
+        }
+        else if ((' ' == line[0]) && ('.' == line[1])) {
+            int fields = sscanf(line, " %63s %lx %lx %511s", name, &addr,
+                                &size, file);
+
+            pending[0] = '\0';
+            if (4 == fields) {
+                add_section(output, name, addr, size, file);
+            }
+            else if (1 == fields) {
+                strcpy(pending, name);
+            }
+        }
+        else if (pending[0]) {
+            if (3 == sscanf(line, " %lx %lx %511s", &addr, &size, file)) {
+                add_section(output, pending, addr, size, file);
+            }
+            pending[0] = '\0';
+        }
+    }
+    fclose(in);
+    return 0;
+}
+
+/*
+ * Read "avr-nm -S" output, symbols take the kind and module of the input
+ * section they are in. Returns 0 on success.
+ */
+static int read_symbols(const char *path)
+{
+    FILE *in = fopen(path, "r");
+    char line[LINE_LEN];
+
+    if (!in) {
+        fprintf(stderr, "budget_check: cannot read %s\n", path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), in) && (MAX_SYMBOLS > g_symbol_count)) {
+        unsigned long addr;
+        unsigned long size;
+        char type;
+        char name[NAME_LEN];
+
+        // Symbols without a size have only the address
+        if ((4 != sscanf(line, "%lx %lx %c %63s", &addr, &size, &type,
+                         name)) ||
+            !size) {
+            continue;
+        }
+        for (uint16_t idx = 0; g_section_count > idx; idx++) {
+            const section_t *section = &g_sections[idx];
+
+            if ((addr >= section->addr) &&
+                (addr < section->addr + section->size)) {
+                symbol_t *symbol = &g_symbols[g_symbol_count++];
+
+                strcpy(symbol->name, name);
+                symbol->size = size;
+                symbol->kind = section->kind;
+                symbol->module = section->module;
+                break;
+            }
+        }
+    }
+    fclose(in);
+    return 0;
+}
+
+static unsigned long module_flash(const module_t *module)
+{
+    return module->size[KIND_TEXT] + module->size[KIND_PROGMEM] +
+           module->size[KIND_DATA];
+}
+
+static unsigned long module_ram(const module_t *module)
+{
+    return module->size[KIND_DATA] + module->size[KIND_BSS];
+}
+
+// Largest use first
+static int compare_modules(const void *a, const void *b)
+{
+    const module_t *ma = a;
+    const module_t *mb = b;
+    unsigned long sa = module_flash(ma) + module_ram(ma);
+    unsigned long sb = module_flash(mb) + module_ram(mb);
+
+    return (sa < sb) - (sa > sb);
+}
+
+static int compare_symbols(const void *a, const void *b)
+{
+    const symbol_t *sa = a;
+    const symbol_t *sb = b;
+
+    return (sa->size < sb->size) - (sa->size > sb->size);
+}
+
+/*
+ * Check one limit, prints and returns 1 if it is exceeded.
+ */
+static int over(const char *what, const char *memory, unsigned long used,
+                unsigned long limit)
+{
+    if (used <= limit) {
+        return 0;
+    }
+    printf("FAIL %s %s %lu > %lu bytes\n", what, memory, used, limit);
+    return 1;
+}
+
+/*
+ * Check the totals and modules against the budget file, returns the
+ * number of exceeded limits, -1 if the file cannot be read.
+ */
+static int check_budget(const char *path, const module_t *total)
+{
+    FILE *in = fopen(path, "r");
+    char line[LINE_LEN];
+    int failures = 0;
+
+    if (!in) {
+        fprintf(stderr, "budget_check: cannot read %s\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), in)) {
+        char first[NAME_LEN];
+        char second[NAME_LEN];
+        const module_t *module = total;
+        const char *memory = first;
+        unsigned long limit;
+
+        line[strcspn(line, "#")] = '\0';
+        if (3 == sscanf(line, "%63s %63s %lu", first, second, &limit)) {
+            module = 0;
+            memory = second;
+            for (uint8_t idx = 0; g_module_count > idx; idx++) {
+                if (0 == strcmp(g_modules[idx].name, first)) {
+                    module = &g_modules[idx];
+                }
+            }
+            if (!module) {
+                continue;
+            }
+        }
+        else if (2 != sscanf(line, "%63s %lu", first, &limit)) {
+            continue;
+        }
+
+        if (0 == strcmp(memory, "flash")) {
+            failures += over(module->name, "flash", module_flash(module),
+                             limit);
+        }
+        else if (0 == strcmp(memory, "ram")) {
+            failures += over(module->name, "ram", module_ram(module), limit);
+        }
+    }
+    fclose(in);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    static module_t sorted[MAX_MODULES];
+    module_t total = {.name = "total"};
+    unsigned int symbols = DEFAULT_SYMBOLS;
+    int failures;
+
+    if ((4 > argc) || (5 < argc)) {
+        fprintf(stderr,
+                "usage: %s main.map main.sym budget.txt [symbols]\n",
+                argv[0]);
+        return 2;
+    }
+    if (5 == argc) {
+        symbols = (unsigned int)atoi(argv[4]);
+    }
+    if (read_map(argv[1]) || read_symbols(argv[2])) {
+        return 2;
+    }
+
+    for (uint8_t idx = 0; g_module_count > idx; idx++) {
+        for (uint8_t kind = 0; KINDS > kind; kind++) {
+            total.size[kind] += g_modules[idx].size[kind];
+        }
+    }
+
+    failures = check_budget(argv[3], &total);
+    if (0 > failures) {
+        return 2;
+    }
+
+    // Symbols refer to g_modules by index, sort a copy
+    memcpy(sorted, g_modules, sizeof(sorted));
+    qsort(sorted, g_module_count, sizeof(module_t), compare_modules);
+    qsort(g_symbols, g_symbol_count, sizeof(symbol_t), compare_symbols);
+
+    printf("%-32s %7s %7s %7s %7s %7s %7s\n", "module", "text", "progmem",
+           "data", "bss", "flash", "ram");
+    for (uint8_t idx = 0; g_module_count >= idx; idx++) {
+        const module_t *module =
+            (g_module_count > idx) ? &sorted[idx] : &total;
+
+        printf("%-32s %7lu %7lu %7lu %7lu %7lu %7lu\n", module->name,
+               module->size[KIND_TEXT], module->size[KIND_PROGMEM],
+               module->size[KIND_DATA], module->size[KIND_BSS],
+               module_flash(module), module_ram(module));
+    }
+
+    printf("\n%7s %-7s %-32s %s\n", "size", "kind", "module", "symbol");
+    for (uint16_t idx = 0; (g_symbol_count > idx) && (symbols > idx); idx++) {
+        const symbol_t *symbol = &g_symbols[idx];
+
+        printf("%7lu %-7s %-32s %s\n", symbol->size,
+               g_kind_names[symbol->kind], g_modules[symbol->module].name,
+               symbol->name);
+    }
+
+    if (failures) {
+        printf("%d limit(s) exceeded\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
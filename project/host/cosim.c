@@ -0,0 +1,841 @@
+/*
+ * Two-board co-simulation on simavr. Runs the unmodified Mega and UNO ELF
+ * images in lock step at 16 MHz, wires their TWI together and plays a
+ * scenario on the Mega inputs:
+ *
+ *   ./cosim ../pm/main.elf ../pu/main.elf < alarm.scn
+ *
+ * The scenario is the event format of hal_host.h: "in" drives Mega pins
+ * (PIR E3, rearm G5), "key" presses keypad keys, "end" sets how long to run
+ * (1 s after the last event without it). Output is the same kind of event
+ * lines with microsecond time stamps:
+ *
+ *   @<ms>.<us> twi <addr> <bytes>     frame seen on the wire, at STOP
+ *   @<ms>.<us> out H3 1               Mega led changed
+ *   @<ms>.<us> key 4                  key pressed
+ *   @<ms>.<us> lcd |<line 0>|<line 1>|   display after the last write
+ *   @<ms>.<us> buzzer <Hz> | off      buzzer output changed
+ *   @<ms>.<us> latency <us>           key press to display updated
+ *   @<ms>.<us> ready twi              UNO acknowledges its address
+ *   @<ms>.<us> ready lcd              first character reached the display
+ *   @<ms>.<us> stack <board> <bytes> of <bytes>   deepest stack use, at end
+ *
+ * The ready lines time the UNO start-up from reset, both cores start at 0.
+ *
+ * The stack use is read from the paint of common/stack.h left in RAM.
+ *
+ * With -b the cycles spent in the functions of g_probes are written as
+ * CSV, see bench_check.c:
+ *
+ *   ./cosim -b bench.csv ../pm/main.elf ../pu/main.elf < bench.scn
+ *
+ * A call lasts from its first instruction until SP is back above the
+ * return address, interrupts taken meanwhile are included. Build the
+ * firmware with DEFS=-DHAL_BENCH so static helpers keep their symbols.
+ *
+ * The wire models clock stretching by holding the Mega while the UNO has
+ * not read the previous byte, the Mega clock stops during the stretch.
+ */
+#include <fcntl.h>
+#include <gelf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "stack.h"
+
+#include "avr_ioport.h"
+#include "avr_twi.h"
+#include "sim_avr.h"
+#include "sim_elf.h"
+
+#define COSIM_F_CPU 16000000UL
+#define COSIM_CYCLES_PER_US (COSIM_F_CPU / 1000000UL)
+
+// Longest a sleeping core may run ahead of the other one
+#define COSIM_QUANTUM_US 5
+
+// Key held down and released, longer than the keypad debounce and scan
+#define COSIM_KEY_DOWN_MS 50
+#define COSIM_KEY_UP_MS 50
+
+// Run on after the last event when the scenario has no "end"
+#define COSIM_TAIL_MS 1000
+
+// Display is reported once writes stopped this long
+#define COSIM_LCD_QUIET_US 500
+
+// Data space addresses, ATmega2560 and ATmega328P register summaries
+#define MEGA_PORTH 0x102
+#define MEGA_DDRK 0x107
+#define MEGA_PORTK 0x108
+#define UNO_PORTB 0x25
+#define UNO_PORTD 0x2B
+#define UNO_TCCR1A 0x80
+#define UNO_TCCR1B 0x81
+#define UNO_OCR1AL 0x88
+#define UNO_OCR1AH 0x89
+#define UNO_TWCR 0xBC
+
+// TWEA and TWEN, the slave acknowledges its address
+#define UNO_TWCR_LISTEN 0x44
+
+// Stack pointer, same on both
+#define AVR_SPL 0x5D
+#define AVR_SPH 0x5E
+
+// UNO LCD pins, see pu/lcd.h
+#define UNO_LCD_RS 2
+#define UNO_LCD_RW 3
+#define UNO_LCD_EN 4
+
+// Mega leds reported, PH3 alarm, PH4 TWI error, PH5 TWI ok
+#define MEGA_LEDS 0x38
+
+#define TWI_QUEUE 64
+#define SCRIPT_LINE 160
+
+typedef struct {
+    avr_t *mega;
+    avr_t *uno;
+
+    // Master messages not yet taken by the slave
+    uint32_t twi_queue[TWI_QUEUE];
+    uint8_t twi_first;
+    uint8_t twi_count;
+
+    // Frame on the wire, printed at STOP
+    uint8_t frame[32];
+    uint8_t frame_len;
+    uint8_t frame_addr;
+
+    // Key down, its row and column bit, 0xFF for none
+    uint8_t key_row;
+    uint8_t key_col;
+    uint8_t cols;
+    avr_irq_t *col_irq[4];
+    uint64_t key_cycle;
+
+    // HD44780 model
+    uint8_t ddram[0x80];
+    uint8_t addr;
+    uint8_t four_bit;
+    uint8_t half;
+    uint8_t high;
+    uint8_t cgram;
+    uint8_t en;
+    uint8_t dirty;
+    uint64_t lcd_cycle;
+    char shown[40];
+
+    // Start-up reported
+    uint8_t ready_twi;
+    uint8_t ready_lcd;
+
+    uint8_t leds;
+    uint32_t buzzer_hz;
+
+    // Probes are timed
+    uint8_t bench;
+
+    // Bottom of the stack paint, UNO [0] and Mega [1]
+    uint16_t heap_start[2];
+} cosim_t;
+
+static cosim_t g_sim;
+
+// Function timed by the benchmark
+typedef struct {
+    uint8_t mega;
+    const char *symbol;
+    const char *label;
+
+    // Flash byte address, 0 if the image has no such symbol
+    uint32_t entry;
+    uint8_t active;
+    uint16_t sp;
+    uint64_t start;
+
+    uint32_t calls;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+} cosim_probe_t;
+
+// Vectors are numbered as in the datasheet interrupt tables minus one
+static cosim_probe_t g_probes[] = {
+    {.mega = 1, .symbol = "hal_twi_write", .label = "hal_twi_write"},
+    {.mega = 1, .symbol = "KEYPAD_GetKey", .label = "KEYPAD_GetKey"},
+    {.mega = 1, .symbol = "keypad_ScanKey", .label = "keypad_ScanKey"},
+    {.mega = 1, .symbol = "verify_code", .label = "verify_code"},
+    {.mega = 1, .symbol = "__vector_32", .label = "TIMER3_COMPA_vect"},
+    {.mega = 1, .symbol = "__vector_12", .label = "WDT_vect"},
+    {.mega = 0, .symbol = "hal_twi_read", .label = "hal_twi_read"},
+    {.mega = 0, .symbol = "parser", .label = "parser"},
+    {.mega = 0, .symbol = "screen_draw", .label = "screen_draw"},
+    {.mega = 0, .symbol = "lcd_flush", .label = "lcd_flush"},
+    {.mega = 0, .symbol = "__vector_24", .label = "TWI_vect"},
+    {.mega = 0, .symbol = "__vector_14", .label = "TIMER0_COMPA_vect"},
+    {.mega = 0, .symbol = "__vector_7", .label = "TIMER2_COMPA_vect"},
+    {.mega = 0, .symbol = "__vector_6", .label = "WDT_vect"},
+};
+
+#define PROBES (sizeof(g_probes) / sizeof(g_probes[0]))
+
+// Scan codes of pm/keypad.c, row in the high nibble, column in the low
+static const struct {
+    char key;
+    uint8_t code;
+} g_keys[] = {
+    {'*', 0xe7}, {'7', 0xeb}, {'4', 0xed}, {'1', 0xee},
+    {'0', 0xd7}, {'8', 0xdb}, {'5', 0xdd}, {'2', 0xde},
+    {'#', 0xb7}, {'9', 0xbb}, {'6', 0xbd}, {'3', 0xbe},
+    {'D', 0x77}, {'C', 0x7b}, {'B', 0x7d}, {'A', 0x7e},
+};
+
+/*
+ * Print an event line stamped with a cycle count.
+ */
+static void cosim_event(uint64_t cycle, const char *format, const char *text)
+{
+    uint64_t us = cycle / COSIM_CYCLES_PER_US;
+
+    printf("@%llu.%03llu ", (unsigned long long)(us / 1000),
+           (unsigned long long)(us % 1000));
+    printf(format, text);
+    putchar('\n');
+}
+
+/*
+ * Bit index of the single zero bit of a nibble.
+ */
+static uint8_t cosim_zero_bit(uint8_t nibble)
+{
+    for (uint8_t bit = 0; 4 > bit; bit++) {
+        if (!(nibble & (1 << bit))) {
+            return bit;
+        }
+    }
+    return 0xFF;
+}
+
+/*
+ * Press or release a key, 0 releases.
+ */
+static void cosim_key(char key)
+{
+    g_sim.key_row = 0xFF;
+    g_sim.key_col = 0xFF;
+    for (uint8_t idx = 0; sizeof(g_keys) / sizeof(g_keys[0]) > idx; idx++) {
+        if (key == g_keys[idx].key) {
+            g_sim.key_row = cosim_zero_bit(g_keys[idx].code >> 4);
+            g_sim.key_col = cosim_zero_bit(g_keys[idx].code & 0x0F);
+        }
+    }
+}
+
+/*
+ * Keypad matrix: a column reads low while the row of the pressed key is
+ * driven low, otherwise the pull-up keeps it high.
+ */
+static void cosim_keypad_poll()
+{
+    uint8_t rows_low = ~g_sim.mega->data[MEGA_PORTK] &
+                       g_sim.mega->data[MEGA_DDRK] & 0xF0;
+    uint8_t cols = 0x0F;
+
+    if ((0xFF != g_sim.key_row) && (rows_low & (0x10 << g_sim.key_row))) {
+        cols &= ~(1 << g_sim.key_col);
+    }
+    for (uint8_t bit = 0; 4 > bit; bit++) {
+        if ((cols ^ g_sim.cols) & (1 << bit)) {
+            avr_raise_irq(g_sim.col_irq[bit], (cols >> bit) & 1);
+        }
+    }
+    g_sim.cols = cols;
+}
+
+/*
+ * Mega leds, reported on change.
+ */
+static void cosim_leds_poll()
+{
+    uint8_t leds = g_sim.mega->data[MEGA_PORTH] & MEGA_LEDS;
+    char text[8];
+
+    for (uint8_t bit = 3; 6 > bit; bit++) {
+        if ((leds ^ g_sim.leds) & (1 << bit)) {
+            snprintf(text, sizeof(text), "H%u %u", bit, (leds >> bit) & 1);
+            cosim_event(g_sim.mega->cycle, "out %s", text);
+        }
+    }
+    g_sim.leds = leds;
+}
+
+/*
+ * One byte written to the HD44780.
+ */
+static void cosim_lcd_byte(uint8_t rs, uint8_t byte)
+{
+    if (rs) {
+        if (!g_sim.cgram) {
+            if (!g_sim.ready_lcd) {
+                g_sim.ready_lcd = 1;
+                cosim_event(g_sim.uno->cycle, "ready %s", "lcd");
+            }
+            g_sim.ddram[g_sim.addr & 0x7F] = byte;
+            g_sim.addr = (g_sim.addr + 1) & 0x7F;
+            g_sim.dirty = 1;
+        }
+        return;
+    }
+    if (byte & 0x80) {
+        g_sim.addr = byte & 0x7F;
+        g_sim.cgram = 0;
+    }
+    else if (byte & 0x40) {
+        g_sim.cgram = 1;
+    }
+    else if (0x01 == byte) {
+        memset(g_sim.ddram, ' ', sizeof(g_sim.ddram));
+        g_sim.addr = 0;
+        g_sim.dirty = 1;
+    }
+    else if (0x02 == (byte & 0xFE)) {
+        g_sim.addr = 0;
+    }
+}
+
+/*
+ * Latch a nibble on the falling edge of E, the controller starts in 8-bit
+ * mode until the function set to 4-bit.
+ */
+static void cosim_lcd_poll()
+{
+    uint8_t portb = g_sim.uno->data[UNO_PORTB];
+    uint8_t en = (portb >> UNO_LCD_EN) & 1;
+    uint8_t nibble = g_sim.uno->data[UNO_PORTD] >> 4;
+    uint8_t rs = (portb >> UNO_LCD_RS) & 1;
+
+    if (g_sim.en && !en && !((portb >> UNO_LCD_RW) & 1)) {
+        g_sim.lcd_cycle = g_sim.uno->cycle;
+        if (!g_sim.four_bit) {
+            if (!rs && (0x2 == nibble)) {
+                g_sim.four_bit = 1;
+                g_sim.half = 0;
+            }
+        }
+        else if (!g_sim.half) {
+            g_sim.high = nibble;
+            g_sim.half = 1;
+        }
+        else {
+            g_sim.half = 0;
+            cosim_lcd_byte(rs, (g_sim.high << 4) | nibble);
+        }
+    }
+    g_sim.en = en;
+}
+
+/*
+ * Print the display once the writes stopped and it changed.
+ */
+static void cosim_lcd_report()
+{
+    char text[sizeof(g_sim.shown)];
+    char *out = text;
+
+    if (!g_sim.dirty ||
+        (COSIM_LCD_QUIET_US * COSIM_CYCLES_PER_US >
+         g_sim.uno->cycle - g_sim.lcd_cycle)) {
+        return;
+    }
+    g_sim.dirty = 0;
+
+    *out++ = '|';
+    for (uint8_t line = 0; 2 > line; line++) {
+        for (uint8_t x = 0; 16 > x; x++) {
+            uint8_t c = g_sim.ddram[(line * 0x40) + x];
+
+            // Bar glyphs 1 - 5, full cell is 5
+            *out++ = (5 == c) ? '=' : ((8 > c) ? '-' : (char)c);
+        }
+        *out++ = '|';
+    }
+    *out = '\0';
+    if (strcmp(text, g_sim.shown)) {
+        strcpy(g_sim.shown, text);
+        cosim_event(g_sim.lcd_cycle, "lcd %s", text);
+        if (g_sim.key_cycle) {
+            char latency[24];
+
+            snprintf(latency, sizeof(latency), "%llu",
+                     (unsigned long long)((g_sim.lcd_cycle - g_sim.key_cycle) /
+                                          COSIM_CYCLES_PER_US));
+            cosim_event(g_sim.lcd_cycle, "latency %s", latency);
+            g_sim.key_cycle = 0;
+        }
+    }
+}
+
+/*
+ * Report when the UNO first listens on its address.
+ */
+static void cosim_twi_poll()
+{
+    if (!g_sim.ready_twi &&
+        (UNO_TWCR_LISTEN == (g_sim.uno->data[UNO_TWCR] & UNO_TWCR_LISTEN))) {
+        g_sim.ready_twi = 1;
+        cosim_event(g_sim.uno->cycle, "ready %s", "twi");
+    }
+}
+
+/*
+ * Buzzer is timer 1 mode 9 toggling OC1A, F_CPU / (4 * N * TOP).
+ */
+static void cosim_buzzer_poll()
+{
+    static const uint16_t prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+    uint16_t ps = prescalers[g_sim.uno->data[UNO_TCCR1B] & 0x07];
+    uint16_t top = g_sim.uno->data[UNO_OCR1AL] |
+                   (g_sim.uno->data[UNO_OCR1AH] << 8);
+    uint32_t hz = 0;
+    char text[16];
+
+    if (ps && top && (g_sim.uno->data[UNO_TCCR1A] & 0xC0)) {
+        hz = COSIM_F_CPU / (4UL * ps * top);
+    }
+    if (hz != g_sim.buzzer_hz) {
+        g_sim.buzzer_hz = hz;
+        if (hz) {
+            snprintf(text, sizeof(text), "%lu", (unsigned long)hz);
+        }
+        else {
+            strcpy(text, "off");
+        }
+        cosim_event(g_sim.uno->cycle, "buzzer %s", text);
+    }
+}
+
+/*
+ * Master side of the wire, messages wait until the slave takes them.
+ */
+static void cosim_mega_twi(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    avr_twi_msg_irq_t msg = {.u.v = value};
+
+    (void)irq;
+    (void)param;
+
+    if (msg.u.twi.msg & TWI_COND_START) {
+        g_sim.frame_len = 0;
+    }
+    if (msg.u.twi.msg & TWI_COND_ADDR) {
+        g_sim.frame_addr = msg.u.twi.addr;
+    }
+    if ((msg.u.twi.msg & TWI_COND_WRITE) &&
+        (sizeof(g_sim.frame) > g_sim.frame_len)) {
+        g_sim.frame[g_sim.frame_len++] = msg.u.twi.data;
+    }
+    if (msg.u.twi.msg & TWI_COND_STOP) {
+        char text[3 * sizeof(g_sim.frame) + 4];
+        int used = snprintf(text, sizeof(text), "%02x", g_sim.frame_addr);
+
+        for (uint8_t idx = 0; g_sim.frame_len > idx; idx++) {
+            used += snprintf(text + used, sizeof(text) - used, " %02x",
+                             g_sim.frame[idx]);
+        }
+        cosim_event(g_sim.mega->cycle, "twi %s", text);
+    }
+
+    if (TWI_QUEUE > g_sim.twi_count) {
+        g_sim.twi_queue[(g_sim.twi_first + g_sim.twi_count++) % TWI_QUEUE] =
+            value;
+    }
+}
+
+/*
+ * Slave answers (ACK) go straight back to the master.
+ */
+static void cosim_uno_twi(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+    avr_raise_irq(avr_io_getirq(g_sim.mega, AVR_IOCTL_TWI_GETIRQ(0),
+                                TWI_IRQ_INPUT),
+                  value);
+}
+
+/*
+ * Hand queued messages to the slave while it is not holding the bus.
+ */
+static void cosim_twi_deliver()
+{
+    avr_irq_t *input =
+        avr_io_getirq(g_sim.uno, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT);
+
+    while (g_sim.twi_count && !(g_sim.uno->data[UNO_TWCR] & 0x80)) {
+        uint32_t value = g_sim.twi_queue[g_sim.twi_first];
+
+        g_sim.twi_first = (g_sim.twi_first + 1) % TWI_QUEUE;
+        g_sim.twi_count--;
+        avr_raise_irq(input, value);
+    }
+}
+
+/*
+ * Sleeping cores skip ahead in time instead of waiting in real time.
+ */
+static void cosim_sleep(avr_t *avr, avr_cycle_count_t how_long)
+{
+    (void)avr;
+    (void)how_long;
+}
+
+/*
+ * Wakes sleeping cores regularly so neither runs far ahead of the other.
+ */
+static avr_cycle_count_t cosim_quantum(avr_t *avr, avr_cycle_count_t when,
+                                       void *param)
+{
+    (void)avr;
+    (void)param;
+    return when + (COSIM_QUANTUM_US * COSIM_CYCLES_PER_US);
+}
+
+/*
+ * Load an ELF image, the MCU name is given since the firmware has no
+ * simavr section.
+ */
+static avr_t *cosim_load(const char *path, const char *mmcu)
+{
+    elf_firmware_t firmware;
+    avr_t *avr;
+
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(path, &firmware)) {
+        fprintf(stderr, "cosim: cannot read %s\n", path);
+        exit(1);
+    }
+    strcpy(firmware.mmcu, mmcu);
+    firmware.frequency = COSIM_F_CPU;
+
+    avr = avr_make_mcu_by_name(firmware.mmcu);
+    if (!avr) {
+        fprintf(stderr, "cosim: no %s in simavr\n", mmcu);
+        exit(1);
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+    avr->sleep = cosim_sleep;
+    avr_cycle_timer_register_usec(avr, COSIM_QUANTUM_US, cosim_quantum, 0);
+    return avr;
+}
+
+/*
+ * Find the probes and the stack paint of one board in the symbol table of
+ * its ELF image.
+ */
+static void cosim_symbols(const char *path, uint8_t mega)
+{
+    int fd = open(path, O_RDONLY);
+    Elf *elf;
+    Elf_Scn *scn = 0;
+
+    if ((0 > fd) || (EV_NONE == elf_version(EV_CURRENT)) ||
+        !(elf = elf_begin(fd, ELF_C_READ, 0))) {
+        fprintf(stderr, "cosim: no symbols in %s\n", path);
+        exit(1);
+    }
+
+    while ((scn = elf_nextscn(elf, scn))) {
+        GElf_Shdr shdr;
+        Elf_Data *data;
+
+        if (!gelf_getshdr(scn, &shdr) || (SHT_SYMTAB != shdr.sh_type) ||
+            !shdr.sh_entsize || !(data = elf_getdata(scn, 0))) {
+            continue;
+        }
+        for (size_t idx = 0; shdr.sh_size / shdr.sh_entsize > idx; idx++) {
+            GElf_Sym sym;
+            const char *name;
+
+            if (!gelf_getsym(data, (int)idx, &sym) ||
+                !(name = elf_strptr(elf, shdr.sh_link, sym.st_name))) {
+                continue;
+            }
+            // Data space addresses are offset by 0x800000 in the image
+            if (0 == strcmp(name, "__heap_start")) {
+                g_sim.heap_start[mega] = (uint16_t)sym.st_value;
+                continue;
+            }
+            if (STT_FUNC != GELF_ST_TYPE(sym.st_info)) {
+                continue;
+            }
+            for (size_t probe = 0; PROBES > probe; probe++) {
+                if ((mega == g_probes[probe].mega) &&
+                    (0 == strcmp(name, g_probes[probe].symbol))) {
+                    g_probes[probe].entry = (uint32_t)sym.st_value;
+                }
+            }
+        }
+    }
+    elf_end(elf);
+    close(fd);
+
+    for (size_t probe = 0; g_sim.bench && (PROBES > probe); probe++) {
+        if ((mega == g_probes[probe].mega) && !g_probes[probe].entry) {
+            fprintf(stderr, "cosim: no %s in %s\n", g_probes[probe].symbol,
+                    path);
+        }
+    }
+}
+
+/*
+ * Time the probes of a board after one of its steps: a call ends when SP
+ * rose above its value at entry, and starts when PC is at the entry.
+ */
+static void cosim_bench_poll(avr_t *avr, uint8_t mega)
+{
+    uint16_t sp = avr->data[AVR_SPL] | (avr->data[AVR_SPH] << 8);
+
+    for (size_t idx = 0; PROBES > idx; idx++) {
+        cosim_probe_t *probe = &g_probes[idx];
+
+        if ((mega != probe->mega) || !probe->entry) {
+            continue;
+        }
+        if (probe->active && (sp > probe->sp)) {
+            uint64_t cycles = avr->cycle - probe->start;
+
+            probe->active = 0;
+            probe->total += cycles;
+            if (!probe->calls || (cycles < probe->min)) {
+                probe->min = cycles;
+            }
+            if (cycles > probe->max) {
+                probe->max = cycles;
+            }
+            probe->calls++;
+        }
+        if (!probe->active && (avr->pc == probe->entry)) {
+            probe->active = 1;
+            probe->sp = sp;
+            probe->start = avr->cycle;
+        }
+    }
+}
+
+/*
+ * Write the probe results as board,function,calls,min,avg,max in cycles.
+ */
+static void cosim_bench_write(const char *path)
+{
+    FILE *out = fopen(path, "w");
+
+    if (!out) {
+        fprintf(stderr, "cosim: cannot write %s\n", path);
+        exit(1);
+    }
+    fprintf(out, "board,function,calls,min,avg,max\n");
+    for (size_t idx = 0; PROBES > idx; idx++) {
+        const cosim_probe_t *probe = &g_probes[idx];
+
+        if (!probe->entry) {
+            continue;
+        }
+        fprintf(out, "%s,%s,%lu,%llu,%llu,%llu\n",
+                probe->mega ? "mega" : "uno", probe->label,
+                (unsigned long)probe->calls, (unsigned long long)probe->min,
+                (unsigned long long)(probe->calls
+                                         ? probe->total / probe->calls
+                                         : 0),
+                (unsigned long long)probe->max);
+    }
+    fclose(out);
+}
+
+/*
+ * Deepest stack use: the paint still intact above __heap_start was never
+ * reached by the stack.
+ */
+static void cosim_stack_report(avr_t *avr, uint8_t mega)
+{
+    uint16_t addr = g_sim.heap_start[mega];
+    char text[48];
+
+    if (!addr) {
+        return;
+    }
+    while ((addr <= avr->ramend) && (STACK_PAINT == avr->data[addr])) {
+        addr++;
+    }
+    snprintf(text, sizeof(text), "%s %u of %u", mega ? "mega" : "uno",
+             avr->ramend + 1 - addr, avr->ramend + 1 - g_sim.heap_start[mega]);
+    cosim_event(avr->cycle, "stack %s", text);
+}
+
+/*
+ * Step the core that is behind, the Mega is held during a stretch.
+ * Returns 0 once either core stopped.
+ */
+static uint8_t cosim_step()
+{
+    avr_t *avr = g_sim.uno;
+    int state;
+
+    if (!g_sim.twi_count && (g_sim.mega->cycle <= g_sim.uno->cycle)) {
+        avr = g_sim.mega;
+    }
+    state = avr_run(avr);
+    if ((cpu_Done == state) || (cpu_Crashed == state)) {
+        fprintf(stderr, "cosim: %s stopped\n",
+                (avr == g_sim.mega) ? "Mega" : "UNO");
+        return 0;
+    }
+
+    if (g_sim.bench) {
+        cosim_bench_poll(avr, avr == g_sim.mega);
+    }
+    if (avr == g_sim.mega) {
+        cosim_keypad_poll();
+        cosim_leds_poll();
+    }
+    else {
+        cosim_twi_poll();
+        cosim_lcd_poll();
+        cosim_lcd_report();
+        cosim_buzzer_poll();
+    }
+    cosim_twi_deliver();
+    return 1;
+}
+
+/*
+ * Run both cores until the given time.
+ */
+static uint8_t cosim_run_until(uint64_t cycle)
+{
+    while ((g_sim.mega->cycle < cycle) || (g_sim.uno->cycle < cycle)) {
+        if (!cosim_step()) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    char line[SCRIPT_LINE];
+    uint64_t end = 0;
+    uint64_t last = 0;
+    const char *bench = 0;
+
+    if ((5 == argc) && (0 == strcmp(argv[1], "-b"))) {
+        bench = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+    if (3 != argc) {
+        fprintf(stderr, "usage: %s [-b bench.csv] pm.elf pu.elf < scenario\n",
+                argv[0]);
+        return 2;
+    }
+
+    memset(&g_sim, 0, sizeof(g_sim));
+    memset(g_sim.ddram, ' ', sizeof(g_sim.ddram));
+    g_sim.key_row = 0xFF;
+    g_sim.mega = cosim_load(argv[1], "atmega2560");
+    g_sim.uno = cosim_load(argv[2], "atmega328p");
+    g_sim.bench = (0 != bench);
+    cosim_symbols(argv[1], 1);
+    cosim_symbols(argv[2], 0);
+
+    // Wire, keypad columns idle high, PIR and rearm low
+    avr_irq_register_notify(
+        avr_io_getirq(g_sim.mega, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+        cosim_mega_twi, 0);
+    avr_irq_register_notify(
+        avr_io_getirq(g_sim.uno, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+        cosim_uno_twi, 0);
+    for (uint8_t bit = 0; 4 > bit; bit++) {
+        g_sim.col_irq[bit] =
+            avr_io_getirq(g_sim.mega, AVR_IOCTL_IOPORT_GETIRQ('K'), bit);
+        avr_raise_irq(g_sim.col_irq[bit], 1);
+    }
+    g_sim.cols = 0x0F;
+    avr_raise_irq(avr_io_getirq(g_sim.mega, AVR_IOCTL_IOPORT_GETIRQ('E'), 3),
+                  0);
+    avr_raise_irq(avr_io_getirq(g_sim.mega, AVR_IOCTL_IOPORT_GETIRQ('G'), 5),
+                  0);
+
+    while (fgets(line, sizeof(line), stdin)) {
+        unsigned long ms;
+        char kind[8];
+        char args[SCRIPT_LINE] = "";
+        uint64_t at;
+
+        if (2 > sscanf(line, "@%lu %7s %[^\n]", &ms, kind, args)) {
+            continue;
+        }
+        at = (uint64_t)ms * 1000 * COSIM_CYCLES_PER_US;
+        if (at < last) {
+            at = last;
+        }
+        if (!cosim_run_until(at)) {
+            return 1;
+        }
+        last = at;
+
+        if (0 == strcmp(kind, "in")) {
+            char port;
+            unsigned int bit;
+            unsigned int level;
+
+            if (3 == sscanf(args, "%c%u %u", &port, &bit, &level)) {
+                avr_raise_irq(avr_io_getirq(g_sim.mega,
+                                            AVR_IOCTL_IOPORT_GETIRQ(port), bit),
+                              level);
+            }
+        }
+        else if (0 == strcmp(kind, "key")) {
+            for (const char *key = args; *key; key++) {
+                char text[2] = {*key, '\0'};
+
+                if (' ' == *key) {
+                    continue;
+                }
+                cosim_key(*key);
+                g_sim.key_cycle = g_sim.mega->cycle;
+                cosim_event(g_sim.mega->cycle, "key %s", text);
+                last += COSIM_KEY_DOWN_MS * 1000 * COSIM_CYCLES_PER_US;
+                if (!cosim_run_until(last)) {
+                    return 1;
+                }
+                cosim_key(0);
+                last += COSIM_KEY_UP_MS * 1000 * COSIM_CYCLES_PER_US;
+                if (!cosim_run_until(last)) {
+                    return 1;
+                }
+            }
+        }
+        else if (0 == strcmp(kind, "end")) {
+            end = at;
+        }
+    }
+
+    if (!end) {
+        end = last + (COSIM_TAIL_MS * 1000 * COSIM_CYCLES_PER_US);
+    }
+    if (!cosim_run_until(end)) {
+        return 1;
+    }
+    cosim_stack_report(g_sim.mega, 1);
+    cosim_stack_report(g_sim.uno, 0);
+    if (bench) {
+        cosim_bench_write(bench);
+    }
+    return 0;
+}
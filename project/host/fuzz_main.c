@@ -0,0 +1,73 @@
+/*
+ * Stand in for the libFuzzer driver where clang is not available: runs a
+ * fuzz target once on each file given, or on each file of the directories
+ * given, e.g. the seed corpus under fuzz/. Build the target with gcc and
+ * -fsanitize=address, see FUZZ_ENGINE in the Makefile.
+ */
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+#ifdef __cplusplus
+}
+#endif
+
+// Longest input read, the targets take a few dozen bytes
+#define INPUT_MAX 4096
+
+/*
+ * Run the target on one file. Returns 0 if it could be read.
+ */
+static int run_file(const char *path)
+{
+    static uint8_t data[INPUT_MAX];
+    FILE *in = fopen(path, "rb");
+    size_t size;
+
+    if (!in) {
+        return 1;
+    }
+    size = fread(data, 1, sizeof(data), in);
+    fclose(in);
+    fprintf(stderr, "%s: %u bytes\n", path, (unsigned)size);
+    LLVMFuzzerTestOneInput(data, size);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int errors = 0;
+    unsigned runs = 0;
+
+    LLVMFuzzerInitialize(&argc, &argv);
+    for (int arg = 1; argc > arg; arg++) {
+        DIR *dir = opendir(argv[arg]);
+        struct dirent *entry;
+
+        if (!dir) {
+            errors += run_file(argv[arg]);
+            runs++;
+            continue;
+        }
+        while ((entry = readdir(dir))) {
+            char path[1024];
+
+            if ('.' == entry->d_name[0]) {
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%s", argv[arg], entry->d_name);
+            errors += run_file(path);
+            runs++;
+        }
+        closedir(dir);
+    }
+    fprintf(stderr, "%u inputs, %d unreadable\n", runs, errors);
+    return errors ? 1 : 0;
+}
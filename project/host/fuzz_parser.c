@@ -0,0 +1,58 @@
+/*
+ * libFuzzer target of the UNO frame parser, parser() of pu/main.c with the
+ * screen modules and the host models of the LCD and buzzer.
+ *
+ *   make fuzz_parser && ./fuzz_parser fuzz/parser
+ *
+ * The input is one frame as hal_twi_read() returns it. It is copied into a
+ * buffer of exactly its length, so AddressSanitizer reports any handler
+ * reading past the frame, e.g. relying on a terminating zero. State such
+ * as the countdown carries over from one input to the next, as on the
+ * board.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The firmware main() stays unused, parser() and its handlers are static
+#define main pu_main
+#include "../pu/main.c"
+#undef main
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void)argc;
+    (void)argv;
+
+    // Display events of the LCD model are not needed
+    if (!freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+    lcd_init(LCD_DISP_ON);
+    bar_init();
+    screen_draw(SCREEN_WELCOME, 0, 0);
+    lcd_flush();
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    uint8_t *frame;
+
+    // hal_twi_read() never returns more
+    if (DATA_SIZE < size) {
+        return 0;
+    }
+    frame = malloc(size ? size : 1);
+    if (!frame) {
+        return 0;
+    }
+    memcpy(frame, data, size);
+    parser(frame, (uint8_t)size);
+    free(frame);
+    return 0;
+}
+
+/*
+ EOF
+ */
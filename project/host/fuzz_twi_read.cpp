@@ -0,0 +1,139 @@
+/*
+ * libFuzzer target of the UNO TWI receive path, hal_twi_read() of pu/hal.c
+ * built against the register model of twi_shim/avr/io.h like twi_fault.
+ *
+ *   make fuzz_twi_read && ./fuzz_twi_read fuzz/twi_read
+ *
+ * The input is the bus as the slave sees it, pairs of <TWSR> <TWDR> that
+ * follow the address match one by one, each time the code clears TWINT.
+ * When the input runs out the master sends STOP and leaves the bus. The
+ * buffer is exactly FRAME_SIZE bytes, so AddressSanitizer reports writes
+ * past it; ACCESS_MAX register accesses without return abort as a hang.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avr/io.h>
+
+#include "hal.h"
+#include "protocol.h"
+
+// Address of the UNO, pu/main.c
+#define SLAVE_ADDRESS 170
+
+// Accesses one frame may take, a frame of the longest input needs a few
+#define ACCESS_MAX 100000
+
+// Status of the address match and of the final STOP
+#define TW_SR_SLA_ACK 0x60
+#define TW_SR_STOP 0xA0
+
+twi_reg_t g_twi_regs[TWI_REGS] = {{TWI_REG_TWBR},
+                                  {TWI_REG_TWSR},
+                                  {TWI_REG_TWAR},
+                                  {TWI_REG_TWDR},
+                                  {TWI_REG_TWCR}};
+
+static uint8_t g_regs[TWI_REGS];
+static uint8_t g_flag;
+
+// Bus still to come, STOP sent once it ran out
+static const uint8_t *g_input;
+static size_t g_left;
+static uint8_t g_stopped;
+static uint32_t g_accesses;
+
+// Stubs of the UART driver pu/hal.c also uses
+FILE mystdin;
+FILE mystdout;
+void usart_init(unsigned int ubrr) {}
+
+/*
+ * TWINT was cleared, the next status and byte arrive.
+ */
+static void bus_next()
+{
+    if (g_stopped) {
+        return;
+    }
+    if (2 <= g_left) {
+        g_regs[TWI_REG_TWSR] = g_input[0] & 0xF8;
+        g_regs[TWI_REG_TWDR] = g_input[1];
+        g_input += 2;
+        g_left -= 2;
+    }
+    else {
+        g_regs[TWI_REG_TWSR] = TW_SR_STOP;
+        g_stopped = 1;
+    }
+    g_flag = 1;
+}
+
+static void bus_access()
+{
+    if (ACCESS_MAX < ++g_accesses) {
+        fprintf(stderr, "fuzz_twi_read: hang, %u register accesses\n",
+                ACCESS_MAX);
+        abort();
+    }
+}
+
+uint8_t twi_reg_read(uint8_t reg)
+{
+    bus_access();
+    if (TWI_REG_TWCR == reg) {
+        return g_regs[reg] | (g_flag << TWINT);
+    }
+    return g_regs[reg];
+}
+
+void twi_reg_write(uint8_t reg, uint8_t value)
+{
+    bus_access();
+    if (TWI_REG_TWCR != reg) {
+        g_regs[reg] = value;
+        return;
+    }
+    g_regs[reg] = value & ~((1 << TWINT) | (1 << TWSTO));
+    if (g_flag && (value & (1 << TWINT))) {
+        g_flag = 0;
+        bus_next();
+    }
+}
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) { return 0; }
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    uint8_t *recv = (uint8_t *)malloc(FRAME_SIZE);
+    uint8_t len;
+
+    if (!recv) {
+        return 0;
+    }
+    for (uint8_t reg = 0; TWI_REGS > reg; reg++) {
+        g_regs[reg] = 0;
+    }
+    g_flag = 0;
+    g_input = data;
+    g_left = size;
+    g_stopped = 0;
+    g_accesses = 0;
+
+    hal_twi_slave_init(SLAVE_ADDRESS);
+
+    // Address match, as pu/main.c sees it after waking up
+    g_regs[TWI_REG_TWSR] = TW_SR_SLA_ACK;
+    g_flag = 1;
+    if (hal_twi_pending()) {
+        len = hal_twi_read(recv, FRAME_SIZE);
+        if (FRAME_SIZE < len) {
+            fprintf(stderr, "fuzz_twi_read: %u bytes read\n", len);
+            abort();
+        }
+        hal_twi_listen();
+    }
+    free(recv);
+    return 0;
+}
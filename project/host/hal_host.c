@@ -0,0 +1,349 @@
+#include "hal_host.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal.h"
+#include "stack.h"
+
+// Longest event line and queued keys / frames
+#define HAL_HOST_LINE 160
+#define HAL_HOST_QUEUE 16
+#define HAL_HOST_FRAME 32
+#define HAL_HOST_EEPROM 1024
+
+// Port letters of HAL_PORT_A - HAL_PORT_L
+static const char g_port_names[HAL_PORTS + 1] = "ABCDEFGHJKL";
+
+// Simulated clock
+static uint32_t g_now_ms = 0;
+
+// Next input event, read ahead so sleep knows when to wake
+static char g_line[HAL_HOST_LINE];
+static uint32_t g_line_ms = 0;
+static uint8_t g_line_valid = 0;
+static uint8_t g_input_done = 0;
+
+// Event output, stdout before the UART took it over
+static FILE *g_out = 0;
+
+// GPIO registers
+static uint8_t g_ddr[HAL_PORTS];
+static uint8_t g_port[HAL_PORTS];
+static uint8_t g_pin[HAL_PORTS];
+
+// Periodic timer, stopped while the period is 0
+static uint16_t g_timer_period = 0;
+static uint32_t g_timer_due = 0;
+
+// TWI slave address and received frames
+static uint8_t g_twi_address = 0;
+static uint8_t g_twi_frames[HAL_HOST_QUEUE][HAL_HOST_FRAME];
+static uint8_t g_twi_lens[HAL_HOST_QUEUE];
+static uint8_t g_twi_first = 0;
+static uint8_t g_twi_count = 0;
+
+// Keypad presses
+static char g_keys[HAL_HOST_QUEUE];
+static uint8_t g_keys_first = 0;
+static uint8_t g_keys_count = 0;
+
+// EEPROM, erased until an eeprom event writes it
+static uint8_t g_eeprom[HAL_HOST_EEPROM];
+static uint8_t g_eeprom_written = 0;
+
+/*
+ * Timer interrupt of boards without a timer handler.
+ */
+__attribute__((weak)) void hal_timer_isr(void) {}
+
+/*
+ * Read hex bytes, returns how many fitted into dest.
+ */
+static uint8_t hal_host_hex(const char *text, uint8_t *dest, uint16_t size)
+{
+    unsigned int byte;
+    int used;
+    uint16_t count = 0;
+
+    while ((size > count) && (1 == sscanf(text, "%x%n", &byte, &used))) {
+        dest[count++] = (uint8_t)byte;
+        text += used;
+    }
+    return (uint8_t)count;
+}
+
+/*
+ * Pin from its name, e.g. "E3", HAL_PORTS << 3 if there is no such pin.
+ */
+static hal_pin_t hal_host_pin(char port, char bit)
+{
+    const char *name = strchr(g_port_names, port);
+
+    if (!port || !name || ('0' > bit) || ('7' < bit)) {
+        return HAL_PORTS << 3;
+    }
+    return (hal_pin_t)(((name - g_port_names) << 3) | (bit - '0'));
+}
+
+/*
+ * Make the next input event available in g_line, 0 at the end of input.
+ */
+static uint8_t hal_host_peek()
+{
+    unsigned long ms;
+    int used;
+
+    while (!g_line_valid && !g_input_done) {
+        if (!fgets(g_line, sizeof(g_line), stdin)) {
+            g_input_done = 1;
+            break;
+        }
+        // Comments, blank lines and anything without a time
+        if (1 != sscanf(g_line, "@%lu %n", &ms, &used)) {
+            continue;
+        }
+        memmove(g_line, g_line + used, strlen(g_line + used) + 1);
+        g_line[strcspn(g_line, "\r\n")] = '\0';
+        g_line_ms = (uint32_t)ms;
+        g_line_valid = 1;
+    }
+    return g_line_valid;
+}
+
+/*
+ * Apply the input event in g_line.
+ */
+static void hal_host_apply()
+{
+    char kind[8] = "";
+    char args[HAL_HOST_LINE] = "";
+    char port = 0;
+    char bit = 0;
+    unsigned int value;
+    unsigned int level;
+
+    g_line_valid = 0;
+    sscanf(g_line, "%7s %[^\n]", kind, args);
+
+    if (0 == strcmp(kind, "in")) {
+        hal_pin_t pin;
+
+        if ((3 != sscanf(args, "%c%c %u", &port, &bit, &level)) ||
+            (HAL_PORTS <= HAL_PIN_PORT(pin = hal_host_pin(port, bit)))) {
+            return;
+        }
+        if (level) {
+            g_pin[HAL_PIN_PORT(pin)] |= HAL_PIN_MASK(pin);
+        }
+        else {
+            g_pin[HAL_PIN_PORT(pin)] &= ~HAL_PIN_MASK(pin);
+        }
+    }
+    else if (0 == strcmp(kind, "key")) {
+        for (const char *key = args; *key; key++) {
+            if ((' ' != *key) && (HAL_HOST_QUEUE > g_keys_count)) {
+                g_keys[(g_keys_first + g_keys_count++) % HAL_HOST_QUEUE] =
+                    *key;
+            }
+        }
+    }
+    else if (0 == strcmp(kind, "twi")) {
+        uint8_t slot = (g_twi_first + g_twi_count) % HAL_HOST_QUEUE;
+        int used;
+
+        // Frames to other addresses are not acknowledged, a full queue
+        // would hold the bus on the board
+        if ((1 != sscanf(args, "%x%n", &value, &used)) ||
+            (g_twi_address != value) || (HAL_HOST_QUEUE <= g_twi_count)) {
+            return;
+        }
+        g_twi_lens[slot] =
+            hal_host_hex(args + used, g_twi_frames[slot], HAL_HOST_FRAME);
+        g_twi_count++;
+    }
+    else if (0 == strcmp(kind, "eeprom")) {
+        int used;
+
+        if (!g_eeprom_written) {
+            memset(g_eeprom, 0xFF, sizeof(g_eeprom));
+            g_eeprom_written = 1;
+        }
+        if ((1 == sscanf(args, "%x%n", &value, &used)) &&
+            (HAL_HOST_EEPROM > value)) {
+            hal_host_hex(args + used, &g_eeprom[value],
+                         HAL_HOST_EEPROM - value);
+        }
+    }
+}
+
+uint32_t hal_host_millis() { return g_now_ms; }
+
+void hal_host_sleep(uint16_t ms)
+{
+    uint32_t wake = g_now_ms + ms;
+    uint8_t pending = hal_host_peek();
+
+    // Nothing can wake the firmware any more
+    if (!pending && !g_timer_period) {
+        fflush(0);
+        exit(0);
+    }
+
+    if (pending && (g_line_ms < wake)) {
+        wake = g_line_ms;
+    }
+    if (g_timer_period && (g_timer_due < wake)) {
+        wake = g_timer_due;
+    }
+    if (wake > g_now_ms) {
+        g_now_ms = wake;
+    }
+
+    if (g_timer_period && (g_timer_due <= g_now_ms)) {
+        g_timer_due += g_timer_period;
+        hal_timer_isr();
+    }
+    else if (pending && (g_line_ms <= g_now_ms)) {
+        hal_host_apply();
+    }
+}
+
+char hal_host_key()
+{
+    char key;
+
+    if (!g_keys_count) {
+        return 0;
+    }
+    key = g_keys[g_keys_first];
+    g_keys_first = (g_keys_first + 1) % HAL_HOST_QUEUE;
+    g_keys_count--;
+    return key;
+}
+
+void hal_host_event(const char *format, ...)
+{
+    FILE *out = g_out ? g_out : stdout;
+    va_list args;
+
+    fprintf(out, "@%lu ", (unsigned long)g_now_ms);
+    va_start(args, format);
+    vfprintf(out, format, args);
+    va_end(args);
+    fputc('\n', out);
+}
+
+void hal_gpio_output(hal_pin_t pin)
+{
+    g_ddr[HAL_PIN_PORT(pin)] |= HAL_PIN_MASK(pin);
+}
+
+void hal_gpio_input(hal_pin_t pin)
+{
+    g_ddr[HAL_PIN_PORT(pin)] &= ~HAL_PIN_MASK(pin);
+}
+
+void hal_gpio_write(hal_pin_t pin, uint8_t level)
+{
+    uint8_t *port = &g_port[HAL_PIN_PORT(pin)];
+    uint8_t old = *port;
+
+    if (level) {
+        *port |= HAL_PIN_MASK(pin);
+    }
+    else {
+        *port &= ~HAL_PIN_MASK(pin);
+    }
+
+    // Outputs report their changes
+    if ((old != *port) && (g_ddr[HAL_PIN_PORT(pin)] & HAL_PIN_MASK(pin))) {
+        hal_host_event("out %c%u %u", g_port_names[HAL_PIN_PORT(pin)],
+                       pin & 7, level ? 1 : 0);
+    }
+}
+
+uint8_t hal_gpio_read(hal_pin_t pin)
+{
+    uint8_t port = HAL_PIN_PORT(pin);
+    uint8_t level = (g_ddr[port] & g_port[port]) | (~g_ddr[port] & g_pin[port]);
+
+    return 0 != (level & HAL_PIN_MASK(pin));
+}
+
+uint8_t hal_eeprom_read(const uint8_t *addr)
+{
+    uintptr_t index = (uintptr_t)addr;
+
+    if (!g_eeprom_written || (HAL_HOST_EEPROM <= index)) {
+        return 0xFF;
+    }
+    return g_eeprom[index];
+}
+
+void hal_twi_master_init() {}
+
+uint8_t hal_twi_write(uint8_t address, const uint8_t *data, uint8_t len)
+{
+    char bytes[3 * HAL_HOST_FRAME + 1] = "";
+
+    for (uint8_t idx = 0; (len > idx) && (HAL_HOST_FRAME > idx); idx++) {
+        sprintf(&bytes[3 * idx], " %02x", data[idx]);
+    }
+    hal_host_event("twi %02x%s", address, bytes);
+    return 0;
+}
+
+void hal_twi_slave_init(uint8_t address) { g_twi_address = address; }
+
+uint8_t hal_twi_pending() { return g_twi_count; }
+
+uint8_t hal_twi_read(uint8_t *dest, uint8_t size)
+{
+    uint8_t len;
+
+    memset(dest, 0, size);
+    if (!g_twi_count) {
+        return 0;
+    }
+    len = g_twi_lens[g_twi_first];
+    if (len > size) {
+        len = size;
+    }
+    memcpy(dest, g_twi_frames[g_twi_first], len);
+    g_twi_first = (g_twi_first + 1) % HAL_HOST_QUEUE;
+    g_twi_count--;
+    return len;
+}
+
+void hal_twi_listen() {}
+
+void hal_uart_init(uint16_t ubrr)
+{
+    (void)ubrr;
+
+    // Debug prints go to stderr, stdout carries the events
+    g_out = stdout;
+    stdout = stderr;
+}
+
+void hal_timer_start_ms(uint16_t period_ms)
+{
+    g_timer_period = period_ms;
+    g_timer_due = g_now_ms + period_ms;
+}
+
+void hal_timer_stop() { g_timer_period = 0; }
+
+// Host stack is not painted, cosim measures the firmware
+uint16_t stack_unused() { return 0; }
+
+uint16_t stack_max_used() { return 0; }
+
+void stack_report() {}
+
+/*
+ EOF
+ */
@@ -0,0 +1,62 @@
+#ifndef _HAL_HOST_H
+#define _HAL_HOST_H
+
+#include <stdint.h>
+
+/*
+ * Host backend of hal.h. Peripherals live in memory and run on a simulated
+ * millisecond clock that only moves while the firmware sleeps, so a
+ * scenario of minutes runs in microseconds.
+ *
+ * The outside world is a stream of event lines, read from stdin and written
+ * to stdout, each stamped with the simulated time in ms:
+ *
+ *   @<ms> in <port><bit> <0|1>       input pin level, e.g. "@100 in E3 1"
+ *   @<ms> key <keys>                 keypad presses, e.g. "@900 key 0423A"
+ *   @<ms> twi <addr> <bytes>         TWI frame, hex, e.g. "@5 twi aa 01"
+ *   @<ms> eeprom <addr> <bytes>      EEPROM contents, hex
+ *   @<ms> out <port><bit> <0|1>      output pin changed (written)
+ *   @<ms> end                        keep running up to this time
+ *
+ * Other kinds are ignored on input, so the output of the Mega is the input
+ * of the UNO: ./pm_host < scenario | ./pu_host
+ * The debug UART is stderr.
+ *
+ * The program exits when the input has ended and no timer is running.
+ */
+
+/*
+ * Simulated time since start.
+ *
+ * @param None
+ * @returns uint32_t milliseconds
+ */
+uint32_t hal_host_millis();
+
+/*
+ * Sleep, the simulated clock runs up to ms ahead. Returns early after an
+ * input event or a timer interrupt, like the CPU waking up.
+ *
+ * @param uint16_t ms longest time to sleep
+ * @returns void
+ */
+void hal_host_sleep(uint16_t ms);
+
+/*
+ * Next key of the key events.
+ *
+ * @param None
+ * @returns char the key, 0 if none is waiting
+ */
+char hal_host_key();
+
+/*
+ * Write an event line to stdout, stamped with the simulated time.
+ *
+ * @param char *format printf format of the event without the time
+ * @returns void
+ */
+void hal_host_event(const char *format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+#endif // _HAL_HOST_H
@@ -0,0 +1,264 @@
+/*
+ * Decoder of the deferred log records of common/log.h.
+ *
+ *   ./log_decode main.elf < capture       text of a UART capture
+ *   ./log_decode -l main.elf              list the IDs and formats
+ *
+ * The formats are read from the .logstr section of the ELF image the
+ * board runs. Arguments are taken as avr-gcc passes them to printf: int
+ * 2 bytes, long 4, little endian. Bytes outside log records are copied
+ * through, so the plain text output of a board still shows.
+ */
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+// Longest single conversion, e.g. "%-08lx"
+#define SPEC_LEN 16
+
+// EI_CLASS of 64 bit images
+#define ELF_CLASS_64 2
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t size;
+} logstr_t;
+
+/*
+ * Little endian value of width bytes.
+ */
+static uint64_t get_le(const uint8_t *data, uint8_t width)
+{
+    uint64_t value = 0;
+
+    while (width--) {
+        value = (value << 8) | data[width];
+    }
+    return value;
+}
+
+/*
+ * Read a whole file. Returns 0 if it cannot be read.
+ */
+static uint8_t *read_file(const char *path, long *size)
+{
+    FILE *in = fopen(path, "rb");
+    uint8_t *data = 0;
+
+    if (in && !fseek(in, 0, SEEK_END) && (0 < (*size = ftell(in))) &&
+        !fseek(in, 0, SEEK_SET) && (data = malloc(*size)) &&
+        (1 != fread(data, *size, 1, in))) {
+        free(data);
+        data = 0;
+    }
+    if (in) {
+        fclose(in);
+    }
+    return data;
+}
+
+/*
+ * Find the .logstr section of a little endian ELF image, 32 bit as made
+ * by avr-gcc or 64 bit. Returns 0 on success.
+ */
+static int find_logstr(const uint8_t *elf, long size, logstr_t *logstr)
+{
+    uint8_t wide;
+    uint64_t shoff;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+    const uint8_t *names;
+
+    if ((64 > size) || memcmp(elf, "\177ELF", 4) || (1 != elf[5])) {
+        return 1;
+    }
+    wide = (ELF_CLASS_64 == elf[4]);
+    shoff = get_le(&elf[wide ? 0x28 : 0x20], wide ? 8 : 4);
+    shentsize = (uint16_t)get_le(&elf[wide ? 0x3A : 0x2E], 2);
+    shnum = (uint16_t)get_le(&elf[wide ? 0x3C : 0x30], 2);
+    shstrndx = (uint16_t)get_le(&elf[wide ? 0x3E : 0x32], 2);
+    if ((shoff + (uint64_t)shnum * shentsize > (uint64_t)size) ||
+        (shstrndx >= shnum)) {
+        return 1;
+    }
+
+    // Section header: name, type, flags, addr, offset, size, ...
+    names = elf + get_le(&elf[shoff + shstrndx * shentsize + (wide ? 24 : 16)],
+                         wide ? 8 : 4);
+    for (uint16_t idx = 0; shnum > idx; idx++) {
+        const uint8_t *header = &elf[shoff + idx * shentsize];
+        uint64_t offset = get_le(&header[wide ? 24 : 16], wide ? 8 : 4);
+        uint64_t length = get_le(&header[wide ? 32 : 20], wide ? 8 : 4);
+
+        if ((0 == strcmp((const char *)names + get_le(header, 4), ".logstr")) &&
+            (offset + length <= (uint64_t)size)) {
+            logstr->data = elf + offset;
+            logstr->size = (uint32_t)length;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Print a record with its format. Returns 0 if the arguments matched.
+ */
+static int print_record(const char *format, const uint8_t *args, uint8_t len)
+{
+    uint8_t used = 0;
+
+    while (*format) {
+        char spec[SPEC_LEN + 2];
+        uint8_t spec_len = 0;
+        uint8_t is_long = 0;
+        char conversion;
+        uint8_t width;
+        uint64_t value;
+
+        if ('%' != *format) {
+            putchar(*format++);
+            continue;
+        }
+        if ('%' == format[1]) {
+            putchar('%');
+            format += 2;
+            continue;
+        }
+
+        // Flags, width and precision copied, length taken out
+        while (*format && !strchr("diouxXcsfp", *format) &&
+               (SPEC_LEN > spec_len)) {
+            if ('l' == *format) {
+                is_long = 1;
+            }
+            else {
+                spec[spec_len++] = *format;
+            }
+            format++;
+        }
+        conversion = *format;
+        if (conversion) {
+            format++;
+        }
+        if (!strchr("diouxXc", conversion) || !conversion) {
+            printf("<%%%c?>", conversion ? conversion : ' ');
+            continue;
+        }
+
+        width = is_long ? 4 : 2;
+        if (used + width > len) {
+            printf("<missing>");
+            return 1;
+        }
+        value = get_le(&args[used], width);
+        used += width;
+
+        spec[spec_len++] = 'l';
+        spec[spec_len++] = conversion;
+        spec[spec_len] = '\0';
+        if (('d' == conversion) || ('i' == conversion)) {
+            long signed_value = is_long ? (long)(int32_t)value
+                                        : (long)(int16_t)value;
+
+            printf(spec, signed_value);
+        }
+        else if ('c' == conversion) {
+            spec[spec_len - 2] = 'c';
+            spec[spec_len - 1] = '\0';
+            printf(spec, (int)(uint8_t)value);
+        }
+        else {
+            printf(spec, (unsigned long)value);
+        }
+    }
+    return (used == len) ? 0 : 1;
+}
+
+/*
+ * List the IDs and formats of the image.
+ */
+static void list_formats(const logstr_t *logstr)
+{
+    uint32_t id = 0;
+
+    while (id < logstr->size) {
+        const char *format = (const char *)&logstr->data[id];
+        uint32_t len = (uint32_t)strnlen(format, logstr->size - id);
+
+        printf("%5lu \"", (unsigned long)id);
+        for (uint32_t idx = 0; len > idx; idx++) {
+            if ('\n' == format[idx]) {
+                printf("\\n");
+            }
+            else {
+                putchar(format[idx]);
+            }
+        }
+        printf("\"\n");
+        id += len + 1;
+
+        // Alignment padding between formats
+        while ((id < logstr->size) && !logstr->data[id]) {
+            id++;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argv[argc - 1];
+    uint8_t *elf;
+    long size = 0;
+    logstr_t logstr;
+    int byte;
+    int errors = 0;
+
+    if ((2 > argc) || (3 < argc) ||
+        ((3 == argc) && strcmp(argv[1], "-l"))) {
+        fprintf(stderr, "usage: %s [-l] main.elf < capture\n", argv[0]);
+        return 2;
+    }
+    if (!(elf = read_file(path, &size)) || find_logstr(elf, size, &logstr)) {
+        fprintf(stderr, "log_decode: no .logstr in %s\n", path);
+        return 2;
+    }
+    if (3 == argc) {
+        list_formats(&logstr);
+        return 0;
+    }
+
+    while (EOF != (byte = getchar())) {
+        uint8_t header[3];
+        uint8_t args[UINT8_MAX];
+        uint16_t id;
+
+        if (LOG_MARK != byte) {
+            putchar(byte);
+            continue;
+        }
+        if ((1 != fread(header, sizeof(header), 1, stdin)) ||
+            (header[2] && (1 != fread(args, header[2], 1, stdin)))) {
+            printf("<cut>\n");
+            break;
+        }
+        id = header[0] | (header[1] << 8);
+        if ((id >= logstr.size) || (id && logstr.data[id - 1])) {
+            printf("<unknown log %u>\n", id);
+            errors++;
+            continue;
+        }
+        if (print_record((const char *)&logstr.data[id], args, header[2])) {
+            printf("<bad arguments of log %u>\n", id);
+            errors++;
+        }
+    }
+    fflush(stdout);
+    free(elf);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Host models of the Mega drivers that sit beside the HAL: the keypad and
+ * the sleep of power.c. Linked with ../pm/main.c and hal_host.c into
+ * pm_host, see hal_host.h for the scenario format.
+ */
+#include "hal_host.h"
+#include "keypad.h"
+#include "power.h"
+
+// Scan interval of the keypad while no key is pressed
+#define KEYPAD_HOST_SCAN_MS 10
+
+void KEYPAD_Init() {}
+
+/*
+ * Wait for the next key event, the firmware is awake and scanning.
+ *
+ * @param None
+ * @returns uint8_t the key
+ */
+uint8_t KEYPAD_GetKey()
+{
+    char key;
+
+    while (!(key = hal_host_key())) {
+        hal_host_sleep(KEYPAD_HOST_SCAN_MS);
+    }
+    return (uint8_t)key;
+}
+
+void power_init() {}
+
+/*
+ * Power-down until the next watchdog wake.
+ *
+ * @param None
+ * @returns void
+ */
+void power_sleep_armed() { hal_host_sleep(POWER_WAKE_PERIOD_MS); }
+
+void power_report() {}
+
+/*
+ EOF
+ */
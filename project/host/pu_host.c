@@ -0,0 +1,203 @@
+/*
+ * Host models of the UNO drivers that sit beside the HAL: the LCD, the
+ * buzzer and the sleep of power.c. Linked with ../pu/main.c, the screen
+ * modules and hal_host.c into pu_host, see hal_host.h for the scenario
+ * format. The display is written as
+ *
+ *   @<ms> lcd |<line 0>|<line 1>|
+ *
+ * whenever a flush changed it, bar glyphs drawn as '=' (full) and '-'.
+ */
+#include <stdio.h>
+
+#include "bar.h"
+#include "buzzer.h"
+#include "hal_host.h"
+#include "lcd.h"
+#include "power.h"
+
+// Framebuffer and what the display shows, as in lcd.c
+static char g_frame[LCD_LINES][LCD_DISP_LENGTH];
+static char g_display[LCD_LINES][LCD_DISP_LENGTH];
+static uint8_t g_frame_x = 0;
+static uint8_t g_frame_y = 0;
+
+/*
+ * Print the display, one event line.
+ */
+static void lcd_host_print()
+{
+    char text[LCD_LINES * (LCD_DISP_LENGTH + 1) + 2];
+    char *out = text;
+
+    *out++ = '|';
+    for (uint8_t y = 0; LCD_LINES > y; y++) {
+        for (uint8_t x = 0; LCD_DISP_LENGTH > x; x++) {
+            char c = g_display[y][x];
+
+            if (BAR_GLYPH_FULL == c) {
+                c = '=';
+            }
+            else if ((BAR_GLYPH_FIRST <= c) && (BAR_GLYPH_FULL > c)) {
+                c = '-';
+            }
+            *out++ = c;
+        }
+        *out++ = '|';
+    }
+    *out = '\0';
+    hal_host_event("lcd %s", text);
+}
+
+void lcd_init(uint8_t dispAttr)
+{
+    (void)dispAttr;
+
+    for (uint8_t y = 0; LCD_LINES > y; y++) {
+        for (uint8_t x = 0; LCD_DISP_LENGTH > x; x++) {
+            g_display[y][x] = ' ';
+        }
+    }
+    lcd_fb_clear();
+}
+
+uint8_t lcd_busy(void) { return 0; }
+
+void lcd_load_glyphs_p(uint8_t first, uint8_t count,
+                       const uint8_t *progmem_glyphs)
+{
+    (void)first;
+    (void)count;
+    (void)progmem_glyphs;
+}
+
+void lcd_fb_clear(void)
+{
+    for (uint8_t y = 0; LCD_LINES > y; y++) {
+        for (uint8_t x = 0; LCD_DISP_LENGTH > x; x++) {
+            g_frame[y][x] = ' ';
+        }
+    }
+    g_frame_x = 0;
+    g_frame_y = 0;
+}
+
+void lcd_fb_gotoxy(uint8_t x, uint8_t y)
+{
+    g_frame_x = x;
+    g_frame_y = y;
+}
+
+void lcd_fb_putc(char c)
+{
+    if ('\n' == c) {
+        g_frame_x = 0;
+        g_frame_y++;
+        return;
+    }
+    // Clip, nothing wraps
+    if ((LCD_DISP_LENGTH > g_frame_x) && (LCD_LINES > g_frame_y)) {
+        g_frame[g_frame_y][g_frame_x] = c;
+    }
+    g_frame_x++;
+}
+
+void lcd_fb_puts(const char *s)
+{
+    while (*s) {
+        lcd_fb_putc(*s++);
+    }
+}
+
+void lcd_fb_puts_p(const char *progmem_s) { lcd_fb_puts(progmem_s); }
+
+/*
+ * Copy the changed cells to the display, counted like lcd.c counts bytes
+ * sent to the controller.
+ */
+uint8_t lcd_flush(void)
+{
+    uint8_t sent = 0;
+
+    for (uint8_t y = 0; LCD_LINES > y; y++) {
+        uint8_t in_run = 0;
+
+        for (uint8_t x = 0; LCD_DISP_LENGTH > x; x++) {
+            if (g_frame[y][x] == g_display[y][x]) {
+                in_run = 0;
+                continue;
+            }
+            if (!in_run) {
+                sent++;
+                in_run = 1;
+            }
+            g_display[y][x] = g_frame[y][x];
+            sent++;
+        }
+    }
+    if (sent) {
+        lcd_host_print();
+    }
+    return sent;
+}
+
+void buzzer_play(uint8_t melody)
+{
+    static const char *const names[] = {"alarm", "wrong", "armed"};
+
+    if (BUZZER_ARMED >= melody) {
+        hal_host_event("buzzer %s", names[melody]);
+    }
+}
+
+uint8_t buzzer_play_rtttl(const char *tune, uint8_t source, uint8_t repeat)
+{
+    (void)tune;
+    (void)repeat;
+    hal_host_event("buzzer rtttl %s",
+                   (BUZZER_EEPROM == source) ? "eeprom" : "flash");
+    return 0;
+}
+
+void buzzer_siren(uint16_t low_top, uint16_t high_top, uint16_t period_ms)
+{
+    hal_host_event("buzzer siren %u %u %u", low_top, high_top, period_ms);
+}
+
+void buzzer_stop() { hal_host_event("buzzer stop"); }
+
+// Watchdog ticks counted before the last restart and when it was
+static uint8_t g_tick_base = 0;
+static uint32_t g_tick_origin = 0;
+
+void power_init() {}
+
+/*
+ * Sleep until the next watchdog tick.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_sleep()
+{
+    hal_host_sleep(POWER_TICK_MS -
+                   (hal_host_millis() - g_tick_origin) % POWER_TICK_MS);
+}
+
+uint8_t power_ticks()
+{
+    return g_tick_base +
+           (uint8_t)((hal_host_millis() - g_tick_origin) / POWER_TICK_MS);
+}
+
+void power_tick_restart()
+{
+    g_tick_base = power_ticks();
+    g_tick_origin = hal_host_millis();
+}
+
+void power_report() {}
+
+/*
+ EOF
+ */
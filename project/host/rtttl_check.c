@@ -0,0 +1,145 @@
+/*
+ * Host side check of the RTTTL decoder used by the Uno buzzer.
+ *
+ * Without arguments decodes the tunes below and compares the produced timer 1
+ * TOP values and durations against expected steps.
+ * With an argument decodes that tune and prints its steps, so installers can
+ * check a tune before writing it to EEPROM with "make eeprom_tune".
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rtttl.h"
+#include "timer1.h"
+
+#define MAX_STEPS 16
+
+typedef struct {
+    const char *tune;
+    uint8_t open_result;
+    uint8_t steps;
+    uint16_t top[MAX_STEPS];
+    uint16_t ms[MAX_STEPS];
+} rtttl_case_t;
+
+static const rtttl_case_t g_cases[] = {
+    // Defaults from the header, b=160 -> whole note 1500 ms
+    {"siren:d=8,o=5,b=160:a,e,a,e",
+     0,
+     4,
+     {568, 757, 568, 757},
+     {187, 187, 187, 187}},
+    // Sharps, dots, pauses, own octaves and european h
+    {"t:d=4,o=6,b=120:8c#7.,p,4b,16h4",
+     0,
+     4,
+     {225, 0, 253, 1012},
+     {375, 500, 500, 125}},
+    // Missing defaults, spaces and upper case, octave below 4
+    {"a: b=100 :C, 2c3",
+     0,
+     2,
+     {477, 3816},
+     {600, 1200}},
+    // Tempo below 4 bpm is 4 bpm, the whole note would not fit 16 bits
+    {"slow:d=4,o=6,b=1:c,2c", 0, 2, {477, 477}, {15000, 30000}},
+    {"slow:d=4,o=6,b=3:c", 0, 1, {477}, {15000}},
+    // Durations above 1/64 are 1/64, d=260 does not wrap to a quarter
+    {"short:d=260,o=6,b=120:c,260c,128c",
+     0,
+     3,
+     {477, 477, 477},
+     {31, 31, 31}},
+    // Tune followed by erased EEPROM
+    {"e:b=100:c\xff\xff\xff", 0, 1, {477}, {600}},
+    // No header at all
+    {"garbage", 1, 0, {0}, {0}},
+    // Erased EEPROM
+    {"\xff\xff", 1, 0, {0}, {0}},
+};
+
+// Plain dereference, tunes are in host memory
+static uint8_t read_host(const char *addr) { return (uint8_t)*addr; }
+
+/*
+ * Decode one case and compare every step, returns number of mismatches.
+ */
+static int check_case(const rtttl_case_t *c)
+{
+    rtttl_t tune;
+    uint16_t top;
+    uint16_t ms;
+    uint8_t idx = 0;
+    int errors = 0;
+
+    if (c->open_result != rtttl_open(&tune, c->tune, read_host)) {
+        printf("FAIL \"%s\": open result\n", c->tune);
+        return 1;
+    }
+    if (c->open_result) {
+        return 0;
+    }
+
+    while (rtttl_next(&tune, &top, &ms)) {
+        if ((idx >= c->steps) || (top != c->top[idx]) || (ms != c->ms[idx])) {
+            printf("FAIL \"%s\": step %u TOP %u ms %u\n", c->tune, idx, top,
+                   ms);
+            errors++;
+        }
+        idx++;
+    }
+    if (idx != c->steps) {
+        printf("FAIL \"%s\": %u steps, expected %u\n", c->tune, idx,
+               c->steps);
+        errors++;
+    }
+
+    // Second pass after rewind must produce the same first step
+    rtttl_rewind(&tune);
+    if (c->steps && (!rtttl_next(&tune, &top, &ms) || (top != c->top[0]))) {
+        printf("FAIL \"%s\": rewind\n", c->tune);
+        errors++;
+    }
+    return errors;
+}
+
+/*
+ * Print the steps of a tune given on the command line.
+ */
+static int dump_tune(const char *text)
+{
+    rtttl_t tune;
+    uint16_t top;
+    uint16_t ms;
+
+    if (rtttl_open(&tune, text, read_host)) {
+        printf("no valid RTTTL header\n");
+        return 1;
+    }
+    while (rtttl_next(&tune, &top, &ms)) {
+        if (top) {
+            printf("TOP %5u  %5u Hz  %5u ms\n", top,
+                   (unsigned)(F_CPU / (4UL * TIMER1_NOTE_PS * top)), ms);
+        }
+        else {
+            printf("pause             %5u ms\n", ms);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int errors = 0;
+
+    if (1 < argc) {
+        return dump_tune(argv[1]);
+    }
+
+    for (unsigned idx = 0; idx < sizeof(g_cases) / sizeof(g_cases[0]);
+         idx++) {
+        errors += check_case(&g_cases[idx]);
+    }
+    printf("%s: %d errors\n", errors ? "FAIL" : "OK", errors);
+    return errors ? 1 : 0;
+}
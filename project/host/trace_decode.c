@@ -0,0 +1,337 @@
+/*
+ * Decoder of the binary trace dumps of common/trace.h.
+ *
+ *   ./trace_decode < capture.bin        dumps in a capture
+ *   ./trace_decode -r /dev/ttyACM0      request one dump from a board
+ *   ./trace_decode -s < capture.bin     dumps as a host scenario
+ *
+ * With -r the serial port is set to 9600 baud raw and 'T' is sent every
+ * 20 ms until the dump starts. Other bytes, e.g. printf output of the
+ * boards, are skipped. Each record is printed on a line of its own:
+ *
+ *   <time ms> <delta ms> <event> <arguments>
+ *
+ * Time is counted from the oldest record. The Mega stamps wrap every
+ * 262 ms of awake time, the decoder assumes records closer than that.
+ *
+ * With -s the PIR, REARM and key records become the input lines of a
+ * scenario for pm_host (see hal_host.h), the other records comments, so a
+ * session on the board can be replayed on the host, see "make replay".
+ * Recordings need the ms wall clock stamps of a TRACE_CLOCK_MS build.
+ */
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "protocol.h"
+#include "trace.h"
+
+// Request interval while waiting for a dump
+#define REQUEST_MS 20
+
+// Header after 'T' 'R': board, tick us, time bits, total, count
+#define HEADER_LEN 9
+
+// Scenario time after the last record, the countdown runs out meanwhile
+#define SCENARIO_TAIL_MS 15000
+
+// Pins of TRACE_INPUT_PIR and TRACE_INPUT_REARM, pm/main.c
+#define SCENARIO_PIN_PIR "E3"
+#define SCENARIO_PIN_REARM "G5"
+
+// Mega states, pm/main.c
+static const char *const g_states[] = {"PIR_SENSE", "TIMER_ON",
+                                       "KEY_INSERTION", "PIR_TIMER_ALARM_OFF"};
+
+static const char *const g_screens[SCREEN_COUNT] = {
+    [SCREEN_WELCOME] = "WELCOME",   [SCREEN_MOVEMENT] = "MOVEMENT",
+    [SCREEN_COUNTDOWN] = "COUNTDOWN", [SCREEN_CORRECT] = "CORRECT",
+    [SCREEN_WRONG] = "WRONG",       [SCREEN_TIME_UP] = "TIME_UP",
+    [SCREEN_ARMED] = "ARMED",       [SCREEN_ERROR] = "ERROR",
+    [SCREEN_USER] = "USER",         [SCREEN_KEYS] = "KEYS",
+};
+
+// Serial port of -r, -1 when reading a capture from stdin
+static int g_port = -1;
+static uint8_t g_requesting = 0;
+
+// Print dumps as scenarios, -s
+static uint8_t g_scenario = 0;
+
+/*
+ * Next input byte, -1 at the end. While requesting, 'T' is sent whenever
+ * the board stays quiet for REQUEST_MS.
+ */
+static int next_byte()
+{
+    uint8_t byte;
+
+    if (0 > g_port) {
+        return getchar();
+    }
+    for (;;) {
+        fd_set fds;
+        struct timeval timeout = {0, REQUEST_MS * 1000};
+
+        FD_ZERO(&fds);
+        FD_SET(g_port, &fds);
+        if (0 < select(g_port + 1, &fds, 0, 0, &timeout)) {
+            return (1 == read(g_port, &byte, 1)) ? byte : -1;
+        }
+        if (g_requesting && (1 != write(g_port, "T", 1))) {
+            return -1;
+        }
+    }
+}
+
+/*
+ * Next byte of a dump with TRACE_ESC undone, -1 at the end.
+ */
+static int next_dump_byte()
+{
+    int byte = next_byte();
+
+    if (TRACE_ESC == byte) {
+        byte = next_byte();
+        if (0 <= byte) {
+            byte ^= TRACE_ESC_XOR;
+        }
+    }
+    return byte;
+}
+
+/*
+ * Open the serial port of a board at 9600 baud, raw. Returns 0 on success.
+ */
+static int open_port(const char *path)
+{
+    struct termios tty;
+
+    g_port = open(path, O_RDWR | O_NOCTTY);
+    if ((0 > g_port) || tcgetattr(g_port, &tty)) {
+        fprintf(stderr, "trace_decode: cannot open %s\n", path);
+        return 1;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B9600);
+    cfsetospeed(&tty, B9600);
+    tty.c_cflag |= CLOCAL | CREAD;
+    return tcsetattr(g_port, TCSANOW, &tty);
+}
+
+static const char *screen_name(uint8_t id)
+{
+    return ((SCREEN_COUNT > id) && g_screens[id]) ? g_screens[id] : "?";
+}
+
+static const char *state_name(uint8_t state)
+{
+    return (sizeof(g_states) / sizeof(g_states[0]) > state) ? g_states[state]
+                                                            : "-";
+}
+
+/*
+ * Print the event of a record.
+ */
+static void print_event(const uint8_t *record)
+{
+    uint8_t arg0 = record[3];
+    uint8_t arg1 = record[4];
+
+    switch (record[2]) {
+    case TRACE_BOOT:
+        printf("boot %s, MCUSR 0x%02x\n",
+               (TRACE_BOARD_MEGA == arg0) ? "mega" : "uno", arg1);
+        break;
+    case TRACE_STATE:
+        printf("state %s <- %s\n", state_name(arg0), state_name(arg1));
+        break;
+    case TRACE_KEY:
+        printf("key %c, %u entered\n", (' ' < arg0) ? arg0 : '?', arg1);
+        break;
+    case TRACE_CODE:
+        printf("code %s, %u keys\n", arg0 ? "correct" : "wrong", arg1);
+        break;
+    case TRACE_TWI_TX:
+        printf("twi tx %s %s\n", screen_name(arg0), arg1 ? "NACK" : "ACK");
+        break;
+    case TRACE_TWI_RX:
+        printf("twi rx %s, %u bytes\n", screen_name(arg0), arg1);
+        break;
+    case TRACE_TWI_BAD:
+        printf("twi bad frame %u, %u bytes\n", arg0, arg1);
+        break;
+    case TRACE_SECOND:
+        printf("second %u\n", arg0);
+        break;
+    case TRACE_COUNTDOWN:
+        printf("countdown %u s\n", arg0);
+        break;
+    case TRACE_INPUT:
+        printf("input %s %u\n",
+               (TRACE_INPUT_PIR == arg0)     ? "PIR"
+               : (TRACE_INPUT_REARM == arg0) ? "REARM"
+                                             : "?",
+               arg1);
+        break;
+    default:
+        printf("event %u %u %u\n", record[2], arg0, arg1);
+        break;
+    }
+}
+
+/*
+ * Print one record.
+ */
+static void print_record(const uint8_t *record, double time_ms,
+                         double delta_ms)
+{
+    printf("%10.3f %+9.3f ", time_ms, delta_ms);
+    print_event(record);
+}
+
+/*
+ * Print one record as a scenario line, inputs replayed, the rest comments.
+ */
+static void print_scenario(const uint8_t *record, unsigned long ms)
+{
+    if ((TRACE_INPUT == record[2]) && ((TRACE_INPUT_PIR == record[3]) ||
+                                       (TRACE_INPUT_REARM == record[3]))) {
+        printf("@%lu in %s %u\n", ms,
+               (TRACE_INPUT_PIR == record[3]) ? SCENARIO_PIN_PIR
+                                              : SCENARIO_PIN_REARM,
+               record[4]);
+    }
+    else if ((TRACE_KEY == record[2]) && (' ' < record[3])) {
+        printf("@%lu key %c\n", ms, record[3]);
+    }
+    else {
+        printf("# @%lu ", ms);
+        print_event(record);
+    }
+}
+
+/*
+ * Read and print a dump after its 'T' 'R'. Returns 0 if the dump was
+ * complete and its sum matched.
+ */
+static int decode_dump()
+{
+    uint8_t header[HEADER_LEN];
+    uint8_t sum = 'T' + 'R';
+    uint32_t tick_us = 0;
+    uint16_t total;
+    uint16_t wrap;
+    uint32_t time = 0;
+    uint16_t last = 0;
+    int byte;
+
+    for (uint8_t idx = 0; HEADER_LEN > idx; idx++) {
+        if (0 > (byte = next_dump_byte())) {
+            return 1;
+        }
+        header[idx] = (uint8_t)byte;
+        sum += header[idx];
+    }
+    for (uint8_t idx = 0; 4 > idx; idx++) {
+        tick_us |= (uint32_t)header[1 + idx] << (8 * idx);
+    }
+    wrap = (16 <= header[5]) ? 0xFFFF : (uint16_t)((1U << header[5]) - 1);
+    total = header[6] | (header[7] << 8);
+
+    printf("%s%s: %u records, %u overwritten, tick %lu us\n",
+           g_scenario ? "# " : "",
+           (TRACE_BOARD_MEGA == header[0]) ? "mega" : "uno", header[8],
+           total - header[8], (unsigned long)tick_us);
+    if (!g_scenario) {
+        printf("%10s %9s event\n", "ms", "delta");
+    }
+    if (g_scenario && (total > header[8])) {
+        fprintf(stderr, "trace_decode: oldest records overwritten, the "
+                        "recording starts late\n");
+    }
+    if (g_scenario && (1000 > tick_us)) {
+        fprintf(stderr, "trace_decode: stamps wrap within ms, record with "
+                        "a TRACE_CLOCK_MS build\n");
+    }
+
+    for (uint8_t count = 0; header[8] > count; count++) {
+        uint8_t record[5];
+        uint16_t stamp;
+        uint16_t delta;
+
+        for (uint8_t idx = 0; sizeof(record) > idx; idx++) {
+            if (0 > (byte = next_dump_byte())) {
+                return 1;
+            }
+            record[idx] = (uint8_t)byte;
+            sum += record[idx];
+        }
+        stamp = record[0] | (record[1] << 8);
+        delta = count ? (uint16_t)((stamp - last) & wrap) : 0;
+        last = stamp;
+        time += delta;
+        if (g_scenario) {
+            print_scenario(record, (unsigned long)time * tick_us / 1000);
+        }
+        else {
+            print_record(record, (double)time * tick_us / 1000.0,
+                         (double)delta * tick_us / 1000.0);
+        }
+    }
+    if (g_scenario) {
+        printf("@%lu end\n",
+               (unsigned long)time * tick_us / 1000 + SCENARIO_TAIL_MS);
+    }
+
+    byte = next_dump_byte();
+    if ((0 > byte) || (sum != (uint8_t)byte)) {
+        printf("bad sum, dump corrupted\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int prev = -1;
+    int byte;
+    int result = 1;
+
+    for (int arg = 1; argc > arg; arg++) {
+        if (0 == strcmp(argv[arg], "-s")) {
+            g_scenario = 1;
+        }
+        else if ((0 == strcmp(argv[arg], "-r")) && (argc > arg + 1) &&
+                 (0 > g_port)) {
+            if (open_port(argv[++arg])) {
+                return 2;
+            }
+            g_requesting = 1;
+        }
+        else {
+            fprintf(stderr, "usage: %s [-s] [-r port] < capture\n", argv[0]);
+            return 2;
+        }
+    }
+
+    while (0 <= (byte = next_byte())) {
+        if (('T' == prev) && ('R' == byte)) {
+            g_requesting = 0;
+            result = decode_dump();
+            if (0 <= g_port) {
+                break;
+            }
+            prev = -1;
+            continue;
+        }
+        prev = byte;
+    }
+    return result;
+}
@@ -0,0 +1,705 @@
+/*
+ * Fault injection on the TWI bus between the boards.
+ *
+ *   ./twi_fault < twi_fault.scn
+ *
+ * The TWI code of both boards, pm/hal.c (master) and pu/hal.c (slave),
+ * runs unmodified against a model of the TWI registers and the bus, see
+ * twi_shim/avr/io.h. The model plays the other board and injects one fault
+ * per scenario line:
+ *
+ *   <role> <fault> <byte> <ms>
+ *
+ *   role   master   pm/hal.c sends, the model is the UNO
+ *          slave    pu/hal.c receives, the model is the Mega
+ *   fault  none     no fault
+ *          nack     the byte is not acknowledged, master only
+ *          arblost  another master wins arbitration on the byte
+ *          vanish   the other board leaves the bus at the byte
+ *          stuck    SDA is held low from the byte on
+ *          buserror illegal START or STOP during the byte
+ *          long     the frame is <byte> bytes long, slave only
+ *   byte   position in the frame, 0 is the address
+ *   ms     how long vanish and stuck last, 0 for ever
+ *
+ * Each line sends FRAMES countdown frames PERIOD_MS apart, the fault hits
+ * frame FAULT_FRAME. Per line the result is:
+ *
+ *   lost     frames not delivered intact
+ *   silent   lost frames the tested side did not notice: hal_twi_write()
+ *            returned 0, or hal_twi_read() never returned them
+ *   garbled  frames hal_twi_read() returned with wrong bytes or length
+ *   recovery ms from the fault to the end of the next intact frame
+ *   hang     a TWI wait loop spun HANG_MS without the bus moving, the board
+ *            would stay there, the rest of the line is lost
+ *
+ * Bus timing follows the TWBR / TWSR the code sets, the CPU runs
+ * ACCESS_CYCLES per register access. The exit status is 1 if a line did
+ * not parse or hung.
+ */
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <avr/io.h>
+
+#include "hal.h"
+#include "protocol.h"
+
+// Frames per line, their period and the frame the fault hits
+#define FRAMES 20
+#define PERIOD_MS 20
+#define FAULT_FRAME 2
+
+// Wait without bus progress that counts as a hang
+#define HANG_MS 1000
+
+// Address both boards use, pm/main.c and pu/main.c
+#define SLAVE_ADDRESS 170
+
+// CPU cycles per register access, a load or store and the loop around it
+#define ACCESS_CYCLES 4
+#define CYCLES_PER_MS (F_CPU / 1000)
+
+// SCL period of the model master on the slave line, TWBR 3 as pm/hal.c
+#define MODEL_SCL_CYCLES 22
+
+// Longest frame of the long fault
+#define LONG_MAX 64
+
+// Status codes, TWSR & 0xF8
+#define TW_START 0x08
+#define TW_REP_START 0x10
+#define TW_MT_SLA_ACK 0x18
+#define TW_MT_SLA_NACK 0x20
+#define TW_MT_DATA_ACK 0x28
+#define TW_MT_DATA_NACK 0x30
+#define TW_ARB_LOST 0x38
+#define TW_SR_SLA_ACK 0x60
+#define TW_SR_DATA_ACK 0x80
+#define TW_SR_DATA_NACK 0x88
+#define TW_SR_STOP 0xA0
+#define TW_NO_INFO 0xF8
+#define TW_BUS_ERROR 0x00
+
+#define FOREVER UINT64_MAX
+
+enum { ROLE_MASTER, ROLE_SLAVE };
+
+enum {
+    FAULT_NONE,
+    FAULT_NACK,
+    FAULT_ARBLOST,
+    FAULT_VANISH,
+    FAULT_STUCK,
+    FAULT_BUSERROR,
+    FAULT_LONG,
+    FAULTS
+};
+
+static const char *const g_faults[FAULTS] = {
+    "none", "nack", "arblost", "vanish", "stuck", "buserror", "long"};
+
+// Bus state of the TWI under test
+enum {
+    MODE_IDLE,   // not addressed, waits for START or its address
+    MODE_ACTIVE, // master transmitter or addressed slave receiver
+    MODE_ERROR,  // bus error, needs TWSTO
+};
+
+typedef struct {
+    uint8_t role;
+    uint8_t fault;
+    uint8_t byte;
+    uint16_t ms;
+} line_t;
+
+typedef struct {
+    // Registers, TWINT is flag
+    uint8_t regs[TWI_REGS];
+    uint8_t flag;
+    uint8_t mode;
+
+    // CPU cycles since the start of the line
+    uint64_t now;
+
+    // Bus event pending, sets TWINT with status at event_at, 0 for none
+    uint64_t event_at;
+    uint8_t event_status;
+    uint8_t event_data;
+
+    // Byte position on the bus, 0 is the address
+    uint8_t pos;
+
+    // Frame damaged on the bus, master line
+    uint8_t failed;
+    uint8_t delivered;
+
+    // Frame the model master sends, slave line
+    uint8_t frame[LONG_MAX];
+    uint8_t frame_len;
+
+    // Hang when now passes it
+    uint64_t guard;
+} bus_t;
+
+twi_reg_t g_twi_regs[TWI_REGS] = {{TWI_REG_TWBR},
+                                  {TWI_REG_TWSR},
+                                  {TWI_REG_TWAR},
+                                  {TWI_REG_TWDR},
+                                  {TWI_REG_TWCR}};
+
+// Port D of the Mega, twi_shim/avr/io.h
+uint8_t g_twi_ddrd;
+uint8_t g_twi_portd;
+
+static bus_t g_bus;
+static line_t g_line;
+static jmp_buf g_hang;
+
+// Frame being sent, fault time and end, 0 before the fault hit
+static uint8_t g_frame;
+static uint64_t g_fault_at;
+static uint64_t g_fault_until;
+
+// Result of the line, kept out of main() across the longjmp of a hang
+static struct {
+    uint16_t lost;
+    uint16_t silent;
+    uint16_t garbled;
+    uint64_t recovered;
+    uint8_t hang;
+} g_result;
+
+// Firmware under test, pu/hal.c
+void TWI_vect();
+
+// Stubs of the UART and timer drivers pm/hal.c and pu/hal.c also use
+FILE mystdin;
+FILE mystdout;
+void usart_init(unsigned int ubrr) {}
+void timer3_init_ctc() {}
+void timer3_clear() {}
+void timer3_set_target(uint16_t value) {}
+
+/*
+ * SCL period in CPU cycles.
+ */
+static uint64_t scl_cycles()
+{
+    uint8_t prescaler = g_bus.regs[TWI_REG_TWSR] & 0x03;
+
+    if (ROLE_SLAVE == g_line.role) {
+        return MODEL_SCL_CYCLES;
+    }
+    return 16 + 2 * (uint64_t)g_bus.regs[TWI_REG_TWBR] * (1U << (2 * prescaler));
+}
+
+/*
+ * Fault of the line hits at this byte position of the fault frame.
+ * Returns non zero once, when it does.
+ */
+static uint8_t fault_hit(uint8_t pos)
+{
+    if ((FAULT_FRAME != g_frame) || (pos != g_line.byte) || g_fault_at) {
+        return 0;
+    }
+    g_fault_at = g_bus.now;
+    g_fault_until =
+        g_line.ms ? g_bus.now + (uint64_t)g_line.ms * CYCLES_PER_MS : FOREVER;
+    return 1;
+}
+
+/*
+ * Lasting fault active now.
+ */
+static uint8_t fault_active(uint8_t fault)
+{
+    return (fault == g_line.fault) && g_fault_at && (g_bus.now < g_fault_until);
+}
+
+static void bus_event(uint64_t at, uint8_t status)
+{
+    g_bus.event_at = at;
+    g_bus.event_status = status;
+}
+
+/*
+ * Time passes by one register access, pending bus events happen.
+ */
+static void bus_step()
+{
+    g_bus.now += ACCESS_CYCLES;
+    if (g_bus.event_at && (g_bus.now >= g_bus.event_at)) {
+        g_bus.event_at = 0;
+        g_bus.flag = 1;
+        g_bus.regs[TWI_REG_TWSR] =
+            (g_bus.regs[TWI_REG_TWSR] & 0x03) | g_bus.event_status;
+        if ((ROLE_SLAVE == g_line.role) &&
+            ((TW_SR_DATA_ACK == g_bus.event_status) ||
+             (TW_SR_DATA_NACK == g_bus.event_status))) {
+            g_bus.regs[TWI_REG_TWDR] = g_bus.event_data;
+        }
+        if ((ROLE_SLAVE == g_line.role) &&
+            (g_bus.regs[TWI_REG_TWCR] & (1 << TWIE))) {
+            TWI_vect();
+        }
+    }
+
+    // The master of a vanish fault comes back, its START ends the frame the
+    // slave is stuck in
+    if ((ROLE_SLAVE == g_line.role) && (FAULT_VANISH == g_line.fault) &&
+        g_fault_at && (g_bus.now >= g_fault_until) &&
+        (MODE_ACTIVE == g_bus.mode) && !g_bus.event_at && !g_bus.flag) {
+        g_bus.mode = MODE_IDLE;
+        bus_event(g_bus.now + scl_cycles(), TW_SR_STOP);
+    }
+
+    if (g_bus.now > g_bus.guard) {
+        longjmp(g_hang, 1);
+    }
+}
+
+/*
+ * Master line: the data or address byte in TWDR goes out, the model UNO
+ * acknowledges it unless a fault says otherwise.
+ */
+static void master_transmit()
+{
+    uint8_t status = g_bus.pos ? TW_MT_DATA_ACK : TW_MT_SLA_ACK;
+
+    if (!g_bus.pos && ((g_bus.regs[TWI_REG_TWDR] >> 1) != (SLAVE_ADDRESS >> 1))) {
+        status = TW_MT_SLA_NACK;
+    }
+    if (fault_hit(g_bus.pos)) {
+        switch (g_line.fault) {
+        case FAULT_NACK:
+            // NACK status is the ACK one + 8
+            status += 0x08;
+            break;
+        case FAULT_ARBLOST:
+        case FAULT_STUCK:
+            status = TW_ARB_LOST;
+            break;
+        case FAULT_BUSERROR:
+            status = TW_BUS_ERROR;
+            break;
+        default:
+            break;
+        }
+    }
+    if (fault_active(FAULT_VANISH) &&
+        ((TW_MT_SLA_ACK == status) || (TW_MT_DATA_ACK == status))) {
+        status += 0x08;
+    }
+    if (fault_active(FAULT_STUCK)) {
+        // SDA low, the first 1 bit of the byte loses arbitration
+        status = TW_ARB_LOST;
+    }
+
+    if ((TW_ARB_LOST == status) || (TW_BUS_ERROR == status)) {
+        g_bus.mode = (TW_BUS_ERROR == status) ? MODE_ERROR : MODE_IDLE;
+    }
+    if ((TW_MT_SLA_ACK != status) && (TW_MT_DATA_ACK != status)) {
+        g_bus.failed = 1;
+    }
+    g_bus.pos++;
+    bus_event(g_bus.now + 9 * scl_cycles(), status);
+}
+
+/*
+ * Master line, TWCR written with TWINT.
+ */
+static void master_control(uint8_t value)
+{
+    if (value & (1 << TWSTO)) {
+        if (MODE_ACTIVE == g_bus.mode) {
+            g_bus.delivered = !g_bus.failed;
+        }
+        g_bus.mode = MODE_IDLE;
+        return;
+    }
+    if (value & (1 << TWSTA)) {
+        uint64_t free = g_bus.now;
+
+        if (MODE_ERROR == g_bus.mode) {
+            return;
+        }
+        if (fault_active(FAULT_STUCK)) {
+            // START waits for the bus to be free
+            if (FOREVER == g_fault_until) {
+                return;
+            }
+            free = g_fault_until;
+        }
+        bus_event(free + scl_cycles(),
+                  (MODE_ACTIVE == g_bus.mode) ? TW_REP_START : TW_START);
+        g_bus.mode = MODE_ACTIVE;
+        g_bus.pos = 0;
+        g_bus.failed = 0;
+        return;
+    }
+
+    // After losing the bus the TWI is a not addressed slave, TWINT stays
+    // clear
+    if (MODE_ACTIVE == g_bus.mode) {
+        master_transmit();
+    }
+}
+
+/*
+ * Slave line: the model Mega puts the next part of its frame on the bus.
+ */
+static void slave_next()
+{
+    uint8_t pos = g_bus.pos;
+    uint8_t ack = g_bus.regs[TWI_REG_TWCR] & (1 << TWEA);
+
+    if (fault_hit(pos)) {
+        switch (g_line.fault) {
+        case FAULT_VANISH:
+            // Master gone, SCL and SDA float high, no STOP
+            return;
+        case FAULT_STUCK:
+            // Nothing moves until SDA is released, then the master sends STOP
+            if (FOREVER != g_fault_until) {
+                g_bus.mode = MODE_IDLE;
+                bus_event(g_fault_until + scl_cycles(), TW_SR_STOP);
+            }
+            return;
+        case FAULT_BUSERROR:
+            g_bus.mode = MODE_ERROR;
+            bus_event(g_bus.now + scl_cycles(), TW_BUS_ERROR);
+            return;
+        case FAULT_ARBLOST:
+            // The other master won, its repeated START ends the frame
+            if (pos) {
+                g_bus.mode = MODE_IDLE;
+                bus_event(g_bus.now + scl_cycles(), TW_SR_STOP);
+            }
+            return;
+        default:
+            break;
+        }
+    }
+
+    if (!pos) {
+        if ((MODE_IDLE != g_bus.mode) || !ack ||
+            !(g_bus.regs[TWI_REG_TWCR] & (1 << TWEN)) ||
+            ((g_bus.regs[TWI_REG_TWAR] >> 1) != (SLAVE_ADDRESS >> 1))) {
+            // Address not acknowledged, the frame is lost
+            return;
+        }
+        g_bus.mode = MODE_ACTIVE;
+        g_bus.pos = 1;
+        bus_event(g_bus.now + 10 * scl_cycles(), TW_SR_SLA_ACK);
+    }
+    else if (pos <= g_bus.frame_len) {
+        g_bus.event_data = g_bus.frame[pos - 1];
+        g_bus.pos++;
+        bus_event(g_bus.now + 9 * scl_cycles(),
+                  ack ? TW_SR_DATA_ACK : TW_SR_DATA_NACK);
+    }
+    else if (pos == g_bus.frame_len + 1) {
+        g_bus.mode = MODE_IDLE;
+        g_bus.pos++;
+        bus_event(g_bus.now + scl_cycles(), TW_SR_STOP);
+    }
+}
+
+/*
+ * Slave line, TWCR written with TWINT.
+ */
+static void slave_control(uint8_t value)
+{
+    uint8_t status = g_bus.regs[TWI_REG_TWSR] & 0xF8;
+
+    if (MODE_ERROR == g_bus.mode) {
+        if (value & (1 << TWSTO)) {
+            g_bus.mode = MODE_IDLE;
+        }
+        return;
+    }
+    if (TW_SR_DATA_NACK == status) {
+        // Not acknowledged, the master gives up on the frame
+        g_bus.mode = MODE_IDLE;
+        return;
+    }
+    if ((MODE_ACTIVE == g_bus.mode) && !fault_active(FAULT_VANISH)) {
+        slave_next();
+    }
+}
+
+uint8_t twi_reg_read(uint8_t reg)
+{
+    bus_step();
+    if (TWI_REG_TWCR == reg) {
+        return g_bus.regs[reg] | (g_bus.flag << TWINT);
+    }
+    return g_bus.regs[reg];
+}
+
+void twi_reg_write(uint8_t reg, uint8_t value)
+{
+    bus_step();
+    if (TWI_REG_TWSR == reg) {
+        // Only the prescaler bits are writable
+        g_bus.regs[reg] = (g_bus.regs[reg] & 0xF8) | (value & 0x03);
+        return;
+    }
+    if (TWI_REG_TWCR != reg) {
+        g_bus.regs[reg] = value;
+        return;
+    }
+
+    // TWSTA stays as written, TWSTO clears itself, TWINT is the flag
+    g_bus.regs[reg] = value & ~((1 << TWINT) | (1 << TWSTO));
+    if (!(value & (1 << TWEN))) {
+        // TWI off, the module resets
+        g_bus.flag = 0;
+        g_bus.event_at = 0;
+        g_bus.mode = MODE_IDLE;
+        g_bus.regs[TWI_REG_TWSR] =
+            (g_bus.regs[TWI_REG_TWSR] & 0x03) | TW_NO_INFO;
+        return;
+    }
+    if (!(value & (1 << TWINT))) {
+        return;
+    }
+    g_bus.flag = 0;
+    if (ROLE_MASTER == g_line.role) {
+        master_control(value);
+    }
+    else {
+        slave_control(value);
+    }
+}
+
+uint8_t twi_pin_read()
+{
+    uint8_t pins = (1 << PD0) | (1 << PD1);
+
+    bus_step();
+    if ((ROLE_MASTER == g_line.role) && fault_active(FAULT_STUCK)) {
+        pins &= ~(1 << PD1);
+    }
+
+    // A pin driven by the port reads low, the port bits are 0 then
+    return pins & ~g_twi_ddrd;
+}
+
+void twi_delay_us(double us)
+{
+    g_bus.now += (uint64_t)(us * CYCLES_PER_MS / 1000);
+    bus_step();
+}
+
+/*
+ * Countdown frame n of the line, longer for the long fault.
+ */
+static uint8_t frame_make(uint8_t *frame)
+{
+    uint8_t len = 3;
+
+    frame[0] = SCREEN_COUNTDOWN;
+    frame[1] = PARAM_SECONDS;
+    frame[2] = FRAMES - g_frame;
+    if ((FAULT_LONG == g_line.fault) && (FAULT_FRAME == g_frame)) {
+        len = (LONG_MAX < g_line.byte) ? LONG_MAX : g_line.byte;
+        for (uint8_t idx = 3; len > idx; idx++) {
+            frame[idx] = idx;
+        }
+    }
+    return len;
+}
+
+/*
+ * Send a frame with pm/hal.c as pm/main.c does. Returns 1 if delivered
+ * intact, *silent set if lost while hal_twi_write() returned 0.
+ */
+static uint8_t master_frame(const uint8_t *frame, uint8_t len,
+                            uint8_t *silent)
+{
+    uint8_t failed;
+
+    g_bus.delivered = 0;
+    hal_twi_master_init();
+    failed = hal_twi_write(SLAVE_ADDRESS, frame, len);
+    *silent = !failed && !g_bus.delivered;
+    return g_bus.delivered;
+}
+
+/*
+ * Receive a frame with pu/hal.c as pu/main.c does, until the bus is quiet.
+ * Returns 1 if received intact, *silent set if hal_twi_read() never
+ * returned anything but empty frames, *garbled counts damaged frames
+ * returned.
+ */
+static uint8_t slave_frame(const uint8_t *frame, uint8_t len,
+                           uint8_t *silent, uint16_t *garbled)
+{
+    uint8_t intact = 0;
+    uint8_t received = 0;
+
+    // No master on the bus to send it
+    if (fault_active(FAULT_VANISH) || fault_active(FAULT_STUCK)) {
+        *silent = 1;
+        return 0;
+    }
+
+    memcpy(g_bus.frame, frame, len);
+    g_bus.frame_len = len;
+    g_bus.pos = 0;
+    if (MODE_IDLE == g_bus.mode) {
+        slave_next();
+    }
+
+    while (g_bus.event_at || g_bus.flag) {
+        uint8_t recv[FRAME_SIZE];
+        uint8_t recv_len;
+
+        if (!hal_twi_pending()) {
+            continue;
+        }
+        recv_len = hal_twi_read(recv, FRAME_SIZE);
+        hal_twi_listen();
+
+        // Dropped, cut short by a bus error or timeout
+        if (!recv_len) {
+            continue;
+        }
+        received = 1;
+        if ((recv_len == len) && !memcmp(recv, frame, len)) {
+            intact = 1;
+        }
+        else {
+            (*garbled)++;
+        }
+    }
+    *silent = !received;
+    return intact;
+}
+
+/*
+ * Play one line, print its result. Returns 1 if it hung.
+ */
+static uint8_t line_run()
+{
+    memset(&g_result, 0, sizeof(g_result));
+    memset(&g_bus, 0, sizeof(g_bus));
+    g_bus.regs[TWI_REG_TWSR] = TW_NO_INFO;
+    g_bus.guard = FOREVER;
+    g_fault_at = 0;
+    g_frame = 0;
+
+    if (setjmp(g_hang)) {
+        g_result.hang = 1;
+        g_result.lost += FRAMES - g_frame;
+    }
+    else {
+        if (ROLE_SLAVE == g_line.role) {
+            hal_twi_slave_init(SLAVE_ADDRESS);
+        }
+        for (; FRAMES > g_frame; g_frame++) {
+            uint8_t frame[LONG_MAX];
+            uint8_t len = frame_make(frame);
+            uint64_t at = (uint64_t)g_frame * PERIOD_MS * CYCLES_PER_MS;
+            uint8_t frame_silent = 0;
+            uint8_t intact;
+
+            // The board sleeps until the frame is due
+            if (g_bus.now < at) {
+                g_bus.now = at;
+            }
+            if ((FAULT_FRAME == g_frame) &&
+                ((FAULT_NONE == g_line.fault) || (FAULT_LONG == g_line.fault))) {
+                g_fault_at = g_bus.now;
+                g_fault_until = g_bus.now;
+            }
+            g_bus.guard = g_bus.now + (uint64_t)HANG_MS * CYCLES_PER_MS;
+
+            if (ROLE_MASTER == g_line.role) {
+                intact = master_frame(frame, len, &frame_silent);
+            }
+            else {
+                intact = slave_frame(frame, len, &frame_silent,
+                                     &g_result.garbled);
+            }
+            if (!intact) {
+                g_result.lost++;
+                g_result.silent += frame_silent;
+            }
+            else if (g_fault_at && !g_result.recovered &&
+                     ((FAULT_FRAME < g_frame) || (FAULT_NONE == g_line.fault))) {
+                g_result.recovered = g_bus.now;
+            }
+        }
+    }
+
+    printf("%-6s %-8s %4u %5u %5u %6u %7u ",
+           (ROLE_MASTER == g_line.role) ? "master" : "slave",
+           g_faults[g_line.fault], g_line.byte, g_line.ms, g_result.lost,
+           g_result.silent, g_result.garbled);
+    if (!g_fault_at) {
+        printf("%8s", "no fault");
+    }
+    else if (g_result.recovered) {
+        printf("%8.2f",
+               (double)(g_result.recovered - g_fault_at) / CYCLES_PER_MS);
+    }
+    else {
+        printf("%8s", "never");
+    }
+    printf(" %s\n", g_result.hang ? "hang" : "-");
+    return g_result.hang;
+}
+
+int main(int argc, char **argv)
+{
+    char text[128];
+    unsigned line_no = 0;
+    int errors = 0;
+
+    if (1 != argc) {
+        fprintf(stderr, "usage: %s < scenario\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-6s %-8s %4s %5s %5s %6s %7s %8s %s\n", "role", "fault", "byte",
+           "ms", "lost", "silent", "garbled", "recovery", "hang");
+    while (fgets(text, sizeof(text), stdin)) {
+        char role[16];
+        char fault[16];
+        unsigned byte;
+        unsigned ms;
+        uint8_t idx;
+
+        line_no++;
+        if (('#' == text[0]) || ('\n' == text[0])) {
+            continue;
+        }
+        if (4 != sscanf(text, "%15s %15s %u %u", role, fault, &byte, &ms)) {
+            fprintf(stderr, "twi_fault: line %u not understood\n", line_no);
+            errors++;
+            continue;
+        }
+        for (idx = 0; (FAULTS > idx) && strcmp(fault, g_faults[idx]); idx++) {
+            ;
+        }
+        if ((FAULTS == idx) || (UINT8_MAX < byte) || (UINT16_MAX < ms) ||
+            (strcmp(role, "master") && strcmp(role, "slave")) ||
+            ((FAULT_NACK == idx) && strcmp(role, "master")) ||
+            ((FAULT_LONG == idx) && strcmp(role, "slave"))) {
+            fprintf(stderr, "twi_fault: line %u not understood\n", line_no);
+            errors++;
+            continue;
+        }
+        g_line.role = strcmp(role, "master") ? ROLE_SLAVE : ROLE_MASTER;
+        g_line.fault = idx;
+        g_line.byte = (uint8_t)byte;
+        g_line.ms = (uint16_t)ms;
+        errors += line_run();
+    }
+    return errors ? 1 : 0;
+}
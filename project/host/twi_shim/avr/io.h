@@ -0,0 +1,100 @@
+#ifndef _TWI_SHIM_IO_H
+#define _TWI_SHIM_IO_H
+
+#include <stdint.h>
+
+/*
+ * avr/io.h of the TWI fault harness, host/twi_fault.cpp. pm/hal.c and
+ * pu/hal.c build against it as C++: the TWI registers are objects that hand
+ * every read and write to the bus model of the harness. Hardware tells a
+ * write from a read (writing TWINT clears it, reading does not), plain
+ * memory cannot, hence C++ for this one harness.
+ */
+
+#define TWI_REG_TWBR 0
+#define TWI_REG_TWSR 1
+#define TWI_REG_TWAR 2
+#define TWI_REG_TWDR 3
+#define TWI_REG_TWCR 4
+#define TWI_REGS 5
+
+// TWCR bits
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+
+/*
+ * Register read by the firmware, the bus model runs first.
+ *
+ * @param uint8_t reg TWI_REG_*
+ * @returns uint8_t register value
+ */
+uint8_t twi_reg_read(uint8_t reg);
+
+/*
+ * Register write by the firmware.
+ *
+ * @param uint8_t reg TWI_REG_*
+ * @param uint8_t value written value
+ * @returns void
+ */
+void twi_reg_write(uint8_t reg, uint8_t value);
+
+struct twi_reg_t {
+    uint8_t reg;
+
+    operator uint8_t() const { return twi_reg_read(reg); }
+
+    twi_reg_t &operator=(int value)
+    {
+        twi_reg_write(reg, (uint8_t)value);
+        return *this;
+    }
+
+    twi_reg_t &operator|=(int value)
+    {
+        twi_reg_write(reg, (uint8_t)(twi_reg_read(reg) | value));
+        return *this;
+    }
+
+    twi_reg_t &operator&=(int value)
+    {
+        twi_reg_write(reg, (uint8_t)(twi_reg_read(reg) & value));
+        return *this;
+    }
+};
+
+extern twi_reg_t g_twi_regs[TWI_REGS];
+
+#define TWBR g_twi_regs[TWI_REG_TWBR]
+#define TWSR g_twi_regs[TWI_REG_TWSR]
+#define TWAR g_twi_regs[TWI_REG_TWAR]
+#define TWDR g_twi_regs[TWI_REG_TWDR]
+#define TWCR g_twi_regs[TWI_REG_TWCR]
+
+/*
+ * SCL and SDA as port pins, pm/hal.c clocks them by hand to clear the bus.
+ * The port and direction registers are plain memory, PIND asks the bus
+ * model.
+ *
+ * @returns uint8_t PIND, SCL on PD0 and SDA on PD1
+ */
+uint8_t twi_pin_read();
+
+extern uint8_t g_twi_ddrd;
+extern uint8_t g_twi_portd;
+
+#define DDRD g_twi_ddrd
+#define PORTD g_twi_portd
+#define PIND twi_pin_read()
+#define PD0 0
+#define PD1 1
+
+// Interrupt handlers are plain functions the bus model calls
+#define ISR(vector) void vector()
+
+#endif // _TWI_SHIM_IO_H
@@ -0,0 +1,16 @@
+#ifndef _TWI_SHIM_DELAY_H
+#define _TWI_SHIM_DELAY_H
+
+/*
+ * util/delay.h of the TWI fault harness, host/twi_fault.cpp. Busy waits
+ * let the time of the bus model pass.
+ *
+ * @param double us microseconds
+ * @returns void
+ */
+void twi_delay_us(double us);
+
+#define _delay_us(us) twi_delay_us(us)
+#define _delay_ms(ms) twi_delay_us((ms) * 1000.0)
+
+#endif // _TWI_SHIM_DELAY_H
@@ -0,0 +1,223 @@
+#include "hal.h"
+
+// Libs
+#include <stdio.h>
+
+#include "delay.h"
+#include "timer3.h"
+#include "uart.h"
+
+/*
+ * AVR backend of the Mega: TWI master, UART and the periodic timer on
+ * timer 3. GPIO and EEPROM are inline in hal.h.
+ */
+
+// Timer 3 ticks per 8 ms at prescaler 1024, exact at 16 MHz
+#define HAL_TIMER_TICKS_8MS (F_CPU / 1024 / 125)
+
+// TWINT polls before a TWI wait gives up, about 10 ms at 16 MHz. The UNO
+// stretches SCL only while its main loop picks a frame up.
+#define TWI_WAIT_POLLS 20000U
+
+// Master transmitter status, TWSR & 0xF8, atmega 2560 doc table 24-3.
+// NO_INFO is also what twi_wait() returns when TWINT never sets.
+#define TWI_START 0x08
+#define TWI_REP_START 0x10
+#define TWI_SLA_W_ACK 0x18
+#define TWI_DATA_ACK 0x28
+#define TWI_DATA_NACK 0x30
+#define TWI_ARB_LOST 0x38
+#define TWI_SLA_R_ACK 0x40
+#define TWI_NO_INFO 0xF8
+
+// SCL and SDA on port D, clocked by hand to clear the bus
+#define TWI_SCL PD0
+#define TWI_SDA PD1
+
+/*
+ * Wait for TWINT, at most TWI_WAIT_POLLS polls.
+ *
+ * @param None
+ * @returns uint8_t TWSR & 0xF8, TWI_NO_INFO on timeout
+ */
+static uint8_t twi_wait()
+{
+    for (uint16_t polls = TWI_WAIT_POLLS; polls; polls--) {
+        if (TWCR & (1 << TWINT)) {
+            return TWSR & 0xF8;
+        }
+    }
+    return TWI_NO_INFO;
+}
+
+/*
+ * I2C bus clear: a slave that lost clocks in the middle of a byte holds
+ * SDA low. Up to nine SCL pulses let it finish the byte, START and STOP
+ * then leave the bus idle. SCL and SDA are open drain, driven by the
+ * direction bit with the port bit low. The TWI must be off.
+ *
+ * @param None
+ * @returns void
+ */
+static void twi_bus_clear()
+{
+    uint8_t port = PORTD;
+
+    PORTD &= ~((1 << TWI_SCL) | (1 << TWI_SDA));
+    for (uint8_t clock = 0; (9 > clock) && !(PIND & (1 << TWI_SDA));
+         clock++) {
+        DDRD |= (1 << TWI_SCL);
+        DELAY_us(5);
+        DDRD &= ~(1 << TWI_SCL);
+        DELAY_us(5);
+    }
+    if (PIND & (1 << TWI_SDA)) {
+        DDRD |= (1 << TWI_SDA);
+        DELAY_us(5);
+        DDRD &= ~(1 << TWI_SDA);
+        DELAY_us(5);
+    }
+    PORTD = port;
+}
+
+/*
+ * Give the bus up after a failed transfer. STOP ends a transfer the Mega
+ * still owns, bus errors included. After a lost arbitration the other
+ * master owns the bus and the TWI is a slave again. After a timeout the
+ * TWI is reset, which releases SCL and SDA, and the bus is cleared.
+ *
+ * @param uint8_t status TWSR & 0xF8 of the failed step or TWI_NO_INFO
+ * @returns void
+ */
+static void twi_release(uint8_t status)
+{
+    if (TWI_ARB_LOST == status) {
+        TWCR = (1 << TWINT) | (1 << TWEN);
+    }
+    else if (TWI_NO_INFO != status) {
+        TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+    }
+    else {
+        TWCR = 0;
+        twi_bus_clear();
+    }
+}
+
+/*
+ * I2C / TWI transmission initialization with 400 kHz clock.
+ * @param None
+ *
+ * @returns void
+ */
+void hal_twi_master_init()
+{
+    // Clear registers
+    TWSR = 0;
+    TWBR = 0;
+    TWCR = 0;
+
+    // Bit Rate generator setup to 400 000 Hz -> F_CPU / (16 + 2 * TWBR *
+    // 4^(TWSR):
+    TWSR = 0x00;         // Prescaler to 1
+    TWBR = 0x03;         // 3x multiplier to achieve 400 kHz
+    TWCR |= (1 << TWEN); // TWI enable
+}
+
+/*
+ * I2C / TWI Transmission from Master to Slave address with data. Every
+ * step is bounded by TWI_WAIT_POLLS, a failed one gives the bus up, see
+ * twi_release(). The next hal_twi_master_init() starts afresh.
+ * @param uint8_t address of the slave to transmit to.
+ * @param uint8_t *data to be sent to the slave.
+ * @param uint8_t len number of bytes
+ *
+ * @returns uint8_t 0 for success, 1 if the frame did not get through: no
+ * START, address or data byte not acknowledged, arbitration lost, bus error
+ * or timeout. The UNO may NACK the last byte, the one that fills its buffer.
+ */
+uint8_t hal_twi_write(uint8_t address, const uint8_t *data, uint8_t len)
+{
+    uint8_t twi_stat = 0;
+
+    // Start transmission:
+    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
+
+    twi_stat = twi_wait();
+    if ((TWI_START != twi_stat) && (TWI_REP_START != twi_stat)) {
+        twi_release(twi_stat);
+        return 1;
+    }
+
+    // Slave address
+    TWDR = address;
+
+    // Clear TWINT to start transmit to slave + write
+    TWCR = (1 << TWINT) | (1 << TWEN);
+
+    twi_stat = twi_wait();
+
+    // Check if the connection to Slave fails (Slave does not return ACK)
+    if ((TWI_SLA_W_ACK != twi_stat) && (TWI_SLA_R_ACK != twi_stat)) {
+        twi_release(twi_stat);
+        return 1;
+    }
+
+    // Send data byte at a time, frames are binary, zero bytes are data.
+    for (uint8_t twi_d_idx = 0; len > twi_d_idx; twi_d_idx++) {
+        TWDR = data[twi_d_idx];
+
+        // Reset TWINT to transmit data
+        TWCR = (1 << TWINT) | (1 << TWEN);
+
+        twi_stat = twi_wait();
+        if ((TWI_DATA_ACK != twi_stat) &&
+            ((TWI_DATA_NACK != twi_stat) || (len != twi_d_idx + 1))) {
+            twi_release(twi_stat);
+            return 1;
+        }
+    }
+
+    // STOP transmission
+    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+    return 0;
+}
+
+/*
+ * Initialize USART0 and point stdin and stdout to it.
+ *
+ * @param uint16_t ubrr baud rate register value
+ * @returns void
+ */
+void hal_uart_init(uint16_t ubrr)
+{
+    usart_init(ubrr);
+    stdin = &mystdin;
+    stdout = &mystdout;
+}
+
+/*
+ * Start timer 3 in CTC mode, HAL_TIMER_ISR() runs every period. Enables
+ * interrupts.
+ *
+ * @param uint16_t period_ms period 1 - 4194 ms
+ * @returns void
+ */
+void hal_timer_start_ms(uint16_t period_ms)
+{
+    // Prescaler 1024, one second by default
+    timer3_init_ctc();
+    timer3_set_target(
+        (uint16_t)(((uint32_t)period_ms * HAL_TIMER_TICKS_8MS) / 8 - 1));
+}
+
+/*
+ * Stop timer 3, its interrupt does not fire again until restarted.
+ *
+ * @param None
+ * @returns void
+ */
+void hal_timer_stop() { timer3_clear(); }
+
+/*
+ EOF
+ */
@@ -75,7 +75,7 @@ Errors and omissions should be reported to codelibraries@exploreembedded.com
 /***************************************************************************************************
                            local function prototypes
  ***************************************************************************************************/
-static uint8_t keypad_ScanKey();
+static HAL_MEASURED uint8_t keypad_ScanKey();
 /**************************************************************************************************/
 
 /***************************************************************************************************
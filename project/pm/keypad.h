@@ -40,8 +40,8 @@ Errors and omissions should be reported to codelibraries@exploreembedded.com
 #ifndef _KEYPAD_H
 #define _KEYPAD_H
 
+#include "hal.h"
 #include "stdutils.h"
-#include <avr/io.h>
 
 /***************************************************************************************************
                                  Hex-Keypad PORT Configuration
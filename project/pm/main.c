@@ -1,21 +1,21 @@
-#include <avr/interrupt.h>
-#include <avr/io.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <util/delay.h>
 
+#include "hal.h"
 #include "keypad.h"
-#include "timer3.h"
-#include "uart.h"
+#include "power.h"
+#include "protocol.h"
+#include "stack.h"
+#include "trace.h"
 
 #define F_CPU 16000000UL
 #define BAUD 9600
 #define MYUBRR F_CPU / 16 / BAUD - 1
 
 #define CODE_ARRAY_LENGTH 5
-#define DATA_SIZE 16
+#define DATA_SIZE FRAME_SIZE
 
 #define SLAVE_ADDRESS 170
 
@@ -35,26 +35,24 @@
 // Countdown in seconds
 #define ALARM_TIMER 10
 
-// Signals to cause an alarm on UNO
-const char g_wrong_code_signal[] = "W";
-const char g_times_up_signal[] = "T";
-
-// Correct signal
-const char g_correct_code_signal[] = "C";
-
-// Timer is started signal
-const char g_movement_signal[] = "M";
-
-// Reset signal
-const char g_rearm_signal[] = "R";
+// Seconds between countdown resync frames, the UNO counts down on its own
+// watchdog in between (about 10 % accurate, 2 s keeps it within 200 ms,
+// below one display refresh). Half the frames of a tick per second.
+#define COUNTDOWN_RESYNC_S 2
 
 
 // All pins that are used on the Mega
-const int PIR_SIGNAL = PE3;
-const int REARM_BTN = PG5;
-const int ALARM_LED = PH3;
-const int I2C_ERROR = PH4;
-const int I2C_OK = PH5;
+const hal_pin_t PIR_SIGNAL = HAL_PIN(E, 3);
+const hal_pin_t REARM_BTN = HAL_PIN(G, 5);
+const hal_pin_t ALARM_LED = HAL_PIN(H, 3);
+const hal_pin_t I2C_ERROR = HAL_PIN(H, 4);
+const hal_pin_t I2C_OK = HAL_PIN(H, 5);
+
+// Key echo latency probe, high from key accepted until the echo frame is
+// sent. Compare with the KEY_ECHO_PROBE pin of the UNO, target < 20 ms.
+#ifdef KEY_ECHO_PROBE
+const hal_pin_t KEY_PROBE = HAL_PIN(H, 6);
+#endif
 
 // State machine state
 volatile int8_t g_state = 0;
@@ -70,27 +68,49 @@ volatile uint8_t g_is_code_valid = 0;
 volatile uint16_t g_second_counter = 0;
 
 /*
- * I2C / TWI transmission initialization with 400 kHz clock.
- * @param None
+ * Send one frame to the UNO, not interrupted by the timer 3 countdown.
+ * @param uint8_t *frame screen ID and parameters
+ * @param uint8_t len number of bytes
+ *
+ * @returns void
+ */
+static void frame_transmit(const uint8_t *frame, uint8_t len);
+
+/*
+ * Send a screen ID to the UNO, with the entered digits if there are any.
+ * @param uint8_t screen SCREEN_* ID from protocol.h
+ * @param char *digits code digits, 0 for none
+ *
+ * @returns void
+ */
+static void screen_transmit(uint8_t screen, const char *digits);
+
+/*
+ * Echo the number of keys entered to the UNO, shown masked.
+ * @param uint8_t count keys entered
  *
  * @returns void
  */
-static void i2c_init();
+static void keys_transmit(uint8_t count);
 
 /*
- * I2C / TWI Transmission from Master to Slave address with data.
- * @param uint8_t address of the slave to transmit to.
- * @param char *data to be sent to the slave.
+ * Send the seconds left of the alarm countdown to the UNO.
+ * @param uint8_t remaining seconds left
  *
  * @returns void
  */
-static void i2c_transmit(uint8_t address, const char *data);
+static void countdown_transmit(uint8_t remaining);
 
 /*
  * Keypad code reading and verification.
  */
 static int8_t read_keypad_code(char *dest, uint8_t code_len);
-static int verify_code(char *to_be_checked, char *correct);
+static HAL_MEASURED int verify_code(char *to_be_checked, char *correct);
+
+/*
+ * Trace PIR and REARM level changes, the input timeline of a recording.
+ */
+static void inputs_trace();
 
 int main(void)
 {
@@ -100,49 +120,70 @@ int main(void)
     // Initialize empty code given by user.
     char users_code[CODE_ARRAY_LENGTH] = {'\0'};
 
+    // Last state in the trace
+    int8_t traced_state = -1;
+
     /*
-     * Data which is send to the UNO, this has the following format:
-     * [ #CODE ] or [ # ] where # represents g_states W, C, T, R, M declared as
-     * global constants.
+     * Data sent to the UNO is a screen ID from protocol.h followed by typed
+     * parameters, the UNO has the text. See screen_transmit().
      */
-    char transfer_data[DATA_SIZE] = {'\0'};
 
     // Output demo for alarm buzzer (currently RED LED)
-    DDRH |= (1 << ALARM_LED) | (1 << I2C_ERROR) | (1 << I2C_OK);
+    hal_gpio_output(ALARM_LED);
+    hal_gpio_output(I2C_ERROR);
+    hal_gpio_output(I2C_OK);
+#ifdef KEY_ECHO_PROBE
+    hal_gpio_output(KEY_PROBE);
+#endif
 
     // PIR sensor input upon Movement
-    DDRE &= ~(1 << PIR_SIGNAL);
+    hal_gpio_input(PIR_SIGNAL);
 
     // Input pin for rearming the system.
-    DDRG &= ~(1 << REARM_BTN);
+    hal_gpio_input(REARM_BTN);
 
     // Initialize connection through USB for debugging.
-    usart_init(MYUBRR);
-    stdin = &mystdin;
-    stdout = &mystdout;
+    hal_uart_init(MYUBRR);
 
     // Keypad initialization for getting users input from keypad.
     KEYPAD_Init();
 
+    // Unused peripherals off, armed states sleep between input samples.
+    power_init();
+
+    // Trace dumps on request over UART
+    trace_init();
+
     // Main logic loop, g_state machine.
     while (1) {
+        trace_poll();
+        if (traced_state != g_state) {
+            TRACE(TRACE_STATE, g_state, traced_state);
+            traced_state = g_state;
+        }
+        inputs_trace();
+
         switch (g_state) {
         case PIR_SENSE:
-            // If PIR senses Movement. Move to TIMER_ON g_state and sent g_state
-            // information to UNO
-            if (PINE & (1 << PIR_SIGNAL)) {
+            // If PIR senses Movement. Move to TIMER_ON g_state, which sends
+            // g_state information to UNO
+            if (hal_gpio_read(PIR_SIGNAL)) {
                 g_state = TIMER_ON;
-                i2c_init();
-                i2c_transmit(SLAVE_ADDRESS, g_movement_signal);
+            }
+            // Nothing sensed, sleep until next sample.
+            else {
+                power_sleep_armed();
             }
             break;
 
         case TIMER_ON:
-            // Initializing timer 3
-            timer3_init_ctc();
+            // Timer interrupt every second
+            hal_timer_start_ms(1000);
 
-            // Setting the timer 3 to interrupt every second
-            timer3_set_interval_second();
+            // UNO starts its countdown in step with timer 3
+            countdown_transmit(ALARM_TIMER);
+            power_report();
+            stack_report();
 
             // Go wait for correct user input.
             g_state = KEY_INSERTION;
@@ -154,49 +195,29 @@ int main(void)
 
             // Verify the codes correctness
             g_is_code_valid = verify_code(users_code, correct_keycode);
+            TRACE(TRACE_CODE, g_is_code_valid, strlen(users_code));
 
             // Case correct code
             if (g_is_code_valid) {
                 // Clear timer, just to be sure
-                timer3_clear();
-
-                // Clear array so no unintended bytes are sent
-                for (uint8_t idx = 0; DATA_SIZE > idx; idx++) {
-                    transfer_data[idx] = '\0';
-                }
-
-                // Concatenate the data to be sent
-                strcat(transfer_data, g_correct_code_signal);
-                strcat(transfer_data, users_code);
+                hal_timer_stop();
 
                 // Turn off alarm led
-                PORTH &= ~(1 << ALARM_LED);
+                hal_gpio_write(ALARM_LED, 0);
 
                 // Transmit information to Slave
-                i2c_init();
-                i2c_transmit(SLAVE_ADDRESS, transfer_data);
+                screen_transmit(SCREEN_CORRECT, users_code);
                 // Move to the final g_state
                 g_state = PIR_TIMER_ALARM_OFF;
             }
 
             // Case wrong code
             else {
-
-                // Clear array of unintended bytes
-                for (uint8_t idx = 0; DATA_SIZE > idx; idx++) {
-                    transfer_data[idx] = '\0';
-                }
-
                 // Turn the Alarm led On
-                PORTH |= (1 << ALARM_LED);
-
-                // Concatenate the data to be sent
-                strcat(transfer_data, g_wrong_code_signal);
-                strcat(transfer_data, users_code);
+                hal_gpio_write(ALARM_LED, 1);
 
                 // Initialize connection and Send data
-                i2c_init();
-                i2c_transmit(SLAVE_ADDRESS, transfer_data);
+                screen_transmit(SCREEN_WRONG, users_code);
             }
             break;
 
@@ -206,20 +227,20 @@ int main(void)
              * We decided to allow rearming only in the case where user gives
              * correct keycode.
              */
-            if (PING & (1 << REARM_BTN)) {
+            if (hal_gpio_read(REARM_BTN)) {
                 // Resetting variables
                 g_state = PIR_SENSE;
                 g_is_code_valid = 0;
                 g_second_counter = 0;
 
-                // Clear transfer_data
-                for (uint8_t idx = 0; DATA_SIZE > idx; idx++) {
-                    transfer_data[idx] = '\0';
-                }
-
                 // Send g_state information to UNO
-                i2c_init();
-                i2c_transmit(SLAVE_ADDRESS, g_rearm_signal);
+                screen_transmit(SCREEN_ARMED, 0);
+                power_report();
+                stack_report();
+            }
+            // Not rearmed, sleep until next sample.
+            else {
+                power_sleep_armed();
             }
             break;
         }
@@ -228,100 +249,12 @@ int main(void)
     return 0;
 }
 
-/*
- * I2C / TWI transmission initialization with 400 kHz clock.
- * @param None
- *
- * @returns void
- */
-static void i2c_init()
-{
-    // Clear registers
-    TWSR = 0;
-    TWBR = 0;
-    TWCR = 0;
-
-    // Bit Rate generator setup to 400 000 Hz -> F_CPU / (16 + 2 * TWBR *
-    // 4^(TWSR):
-    TWSR = 0x00;         // Prescaler to 1
-    TWBR = 0x03;         // 3x multiplier to achieve 400 kHz
-    TWCR |= (1 << TWEN); // TWI enable
-}
-
-/*
- * I2C / TWI Transmission from Master to Slave address with data.
- * @param uint8_t address of the slave to transmit to.
- * @param char *data to be sent to the slave.
- *
- * @returns void
- */
-static void i2c_transmit(uint8_t address, const char *data)
-{
-    uint8_t twi_stat = 0;
-
-    // Start transmission:
-    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-
-    while (!(TWCR & (1 << TWINT))) {
-        ;
-    }
-
-    // Read status from TWI status register
-    twi_stat = (TWSR & 0xF8);
-
-    // Slave address
-    TWDR = address;
-
-    // Clear TWINT to start transmit to slave + write
-    TWCR = (1 << TWINT) | (1 << TWEN);
-
-    // Wait TWINT to set
-    while (!(TWCR & (1 << TWINT))) {
-        ;
-    }
-
-    twi_stat = (TWSR & 0xF8);
-
-    // Check if the connection to Slave fails (Slave does not return ACK)
-    if ((twi_stat != 0x18) && (twi_stat != 0x40)) {
-        // Set error led ON
-        PORTH |= (1 << I2C_ERROR);
-        // Verify that OK led is OFF
-        PORTH &= ~(1 << I2C_OK);
-        return;
-    }
-
-    // Set ok led ON
-    PORTH |= (1 << I2C_OK);
-    // Set error led OFF
-    PORTH &= ~(1 << I2C_ERROR);
-
-    // Send data byte at a time until either 16 bytes has been sent or data
-    // array has reached its end.
-    for (uint8_t twi_d_idx = 0;
-         (DATA_SIZE > twi_d_idx) && ('\0' != data[twi_d_idx]); twi_d_idx++) {
-        TWDR = data[twi_d_idx];
-
-        // Reset TWINT to transmit data
-        TWCR = (1 << TWINT) | (1 << TWEN);
-
-        // Wait for TWINT to set
-        while (!(TWCR & (1 << TWINT))) {
-            ;
-        }
-
-        twi_stat = (TWSR & 0xF8);
-    }
-
-    // STOP transmission
-    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
-}
-
 /*
  * Stores users given key code from the keypad to the destination array to be
  * verified. When user has given code_len amount of digits (only last ones are
  * stored) and user gives [A]ccept the loop ends and the code is verified.
- * User can also give [D]elete to remove previous digit from storage.
+ * User can also give [D]elete to remove previous digit from storage and
+ * [C]lear to start over. Every digit, delete and clear is echoed to the UNO.
  *
  * @param char *dest        Destination array
  * @param uint8_t code_len  Destination array length
@@ -342,6 +275,11 @@ static int8_t read_keypad_code(char *dest, uint8_t code_len)
     // user has given long enough password.
     for (;;) {
         chr = KEYPAD_GetKey();
+        TRACE(TRACE_KEY, chr, index);
+
+#ifdef KEY_ECHO_PROBE
+        hal_gpio_write(KEY_PROBE, 1);
+#endif
 
         // Check for digit in range 0 - 9
         if (('0' <= chr) && ('9' >= chr)) {
@@ -351,19 +289,35 @@ static int8_t read_keypad_code(char *dest, uint8_t code_len)
                 index--;
             }
             dest[index++] = chr;
+            keys_transmit(index);
         }
 
         // Allow the [D]eletion of previous char if it exists
         else if (chr == 'D' && index > 0) {
             index--;
+            keys_transmit(index);
+        }
+
+        // [C]lear all digits
+        else if (chr == 'C' && index > 0) {
+            index = 0;
+            keys_transmit(index);
         }
 
         // End point to exit function if enough digits given and [A]ccept
         else if (('A' == chr) && (index == code_len)) {
             break;
         }
+
+#ifdef KEY_ECHO_PROBE
+        hal_gpio_write(KEY_PROBE, 0);
+#endif
     }
 
+#ifdef KEY_ECHO_PROBE
+    hal_gpio_write(KEY_PROBE, 0);
+#endif
+
     // Make sure that the dest ends.
     dest[code_len] = '\0';
     return 0;
@@ -393,24 +347,138 @@ static int verify_code(char *to_be_checked, char *correct)
 }
 
 /*
- * Interrupt Service Routine for Timer 3.
- * Causes alarm if 10 seconds have passed.
+ * Send one frame to the UNO. The timer interrupt sends countdown frames,
+ * it must not start a transmission in the middle of one from the main loop.
+ * The error led is lit while the UNO does not acknowledge.
+ * @param uint8_t *frame screen ID and parameters
+ * @param uint8_t len number of bytes, at most DATA_SIZE
+ *
+ * @returns void
  */
-ISR(TIMER3_COMPA_vect)
+static void frame_transmit(const uint8_t *frame, uint8_t len)
+{
+    HAL_ATOMIC
+    {
+        hal_twi_master_init();
+        uint8_t failed = hal_twi_write(SLAVE_ADDRESS, frame, len);
+
+        TRACE(TRACE_TWI_TX, frame[0], failed);
+
+        hal_gpio_write(I2C_ERROR, failed);
+        hal_gpio_write(I2C_OK, !failed);
+    }
+}
+
+/*
+ * Echo the number of keys entered to the UNO, shown masked.
+ * @param uint8_t count keys entered
+ *
+ * @returns void
+ */
+static void keys_transmit(uint8_t count)
+{
+    const uint8_t frame[] = {SCREEN_KEYS, PARAM_KEYS, count};
+
+    frame_transmit(frame, sizeof(frame));
+}
+
+/*
+ * Send a screen ID to the UNO, with the entered digits if there are any.
+ * Digits are packed two per byte: [ ID ] [ PARAM_DIGITS ] [ count ] [ BCD ]
+ * @param uint8_t screen SCREEN_* ID from protocol.h
+ * @param char *digits code digits, 0 for none
+ *
+ * @returns void
+ */
+static void screen_transmit(uint8_t screen, const char *digits)
+{
+    uint8_t frame[DATA_SIZE] = {0};
+    uint8_t len = 0;
+    uint8_t count = 0;
+
+    frame[len++] = screen;
+    if (digits) {
+        frame[len++] = PARAM_DIGITS;
+        len++; // count, known after packing
+        while (('\0' != digits[count]) && (PARAM_DIGITS_MAX > count)) {
+            if (count & 1) {
+                frame[len++] |= (digits[count] - '0') & 0x0F;
+            }
+            else {
+                frame[len] = (digits[count] - '0') << 4;
+            }
+            count++;
+        }
+        // Odd count, last high nibble is in use
+        if (count & 1) {
+            len++;
+        }
+        frame[2] = count;
+    }
+
+    frame_transmit(frame, len);
+}
+
+/*
+ * Send the seconds left of the alarm countdown to the UNO.
+ * Called from the timer 3 interrupt, no printf family.
+ * @param uint8_t remaining seconds left
+ *
+ * @returns void
+ */
+static void countdown_transmit(uint8_t remaining)
+{
+    const uint8_t frame[] = {SCREEN_COUNTDOWN, PARAM_SECONDS, remaining,
+                             PARAM_SECONDS, ALARM_TIMER};
+
+    frame_transmit(frame, sizeof(frame));
+}
+
+/*
+ * Trace PIR and REARM level changes as the main loop samples them, every
+ * watchdog wake while armed. Replayed by the host, see trace_decode -s.
+ *
+ * @param None
+ * @returns void
+ */
+static void inputs_trace()
+{
+    static uint8_t traced = 0;
+    uint8_t pir = hal_gpio_read(PIR_SIGNAL) ? 1 : 0;
+    uint8_t rearm = hal_gpio_read(REARM_BTN) ? 2 : 0;
+
+    if (pir != (traced & 1)) {
+        TRACE(TRACE_INPUT, TRACE_INPUT_PIR, pir);
+    }
+    if (rearm != (traced & 2)) {
+        TRACE(TRACE_INPUT, TRACE_INPUT_REARM, rearm >> 1);
+    }
+    traced = pir | rearm;
+}
+
+/*
+ * Interrupt Service Routine for the second timer.
+ * Causes alarm if 10 seconds have passed, otherwise resyncs the UNO
+ * countdown every COUNTDOWN_RESYNC_S seconds.
+ */
+HAL_TIMER_ISR()
 {
-    TCNT3 = 0;
     g_second_counter++;
+    TRACE(TRACE_SECOND, g_second_counter, 0);
     if (ALARM_TIMER <= g_second_counter) {
         // Led indicating ALARM is ON
-        PORTH |= (1 << ALARM_LED);
+        hal_gpio_write(ALARM_LED, 1);
 
         // Timer is cleared so this interrupt does not fire again until reset
-        timer3_clear();
+        hal_timer_stop();
         g_second_counter = 0;
 
         // Send system g_state information to UNO
-        i2c_init();
-        i2c_transmit(SLAVE_ADDRESS, g_times_up_signal);
+        screen_transmit(SCREEN_TIME_UP, 0);
+    }
+    else if (0 == (ALARM_TIMER - g_second_counter) % COUNTDOWN_RESYNC_S) {
+        // UNO counts down by itself, resync now and then
+        countdown_transmit(ALARM_TIMER - g_second_counter);
     }
 }
 
@@ -0,0 +1,165 @@
+#include "power.h"
+
+#include "log.h"
+
+// Libs
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// Timer 5 overflows while awake, one overflow = 65536 ticks.
+static volatile uint32_t g_awake_overflows = 0;
+
+// Watchdog wakes, each one ends POWER_WAKE_PERIOD_MS of power-down.
+static volatile uint32_t g_sleep_ticks = 0;
+
+// Whole ms of power-down, timer 5 overflows and reports, see power_millis()
+static volatile uint16_t g_clock_ms = 0;
+
+/*
+ * Shut down peripherals unused by the alarm via PRR0 / PRR1 and start the
+ * awake time counter.
+ *
+ * @param None
+ * @returns void
+ */
+void power_init()
+{
+    // ADC has to be disabled before it is shut down, comparator is not used.
+    ADCSRA &= ~(1 << ADEN);
+    ACSR |= (1 << ACD);
+
+    // TWI, USART0, timer 3 and timer 5 stay powered: 2560 doc 54 chapter 11.10
+    PRR0 |= (1 << PRADC) | (1 << PRSPI) | (1 << PRTIM0) | (1 << PRTIM1) |
+            (1 << PRTIM2);
+    PRR1 |= (1 << PRUSART1) | (1 << PRUSART2) | (1 << PRUSART3) |
+            (1 << PRTIM4);
+
+    // Timer 5 normal mode, prescaler 64. Clock is stopped in power-down so
+    // the counter only advances while awake.
+    TCCR5A = 0;
+    TCCR5B = (1 << CS51) | (1 << CS50);
+    TCNT5 = 0;
+    TIMSK5 |= (1 << TOIE5);
+
+    sei();
+}
+
+/*
+ * Sleep in power-down until the next watchdog wake. Caller polls its inputs
+ * after return.
+ *
+ * @param None
+ * @returns void
+ */
+void power_sleep_armed()
+{
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+
+    cli();
+
+    // Watchdog in interrupt mode, 16 ms: 2560 doc 63 table 12-1. Timed
+    // sequence, WDE and WDCE first then the new configuration.
+    wdt_reset();
+    WDTCSR = (1 << WDCE) | (1 << WDE);
+    WDTCSR = (1 << WDIE);
+
+    // sei() right before sleep_cpu() so no wake up is lost in between.
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+
+    wdt_disable();
+}
+
+/*
+ * Print time spent awake / asleep since previous report and an average
+ * current estimate over UART, then reset the counters.
+ *
+ * @param None
+ * @returns void
+ */
+void power_report()
+{
+    uint32_t overflows;
+    uint16_t ticks;
+    uint32_t sleep_ticks;
+    uint32_t awake_ms;
+    uint32_t asleep_ms;
+    uint32_t duty = 0;
+
+    cli();
+    overflows = g_awake_overflows;
+    ticks = TCNT5;
+    sleep_ticks = g_sleep_ticks;
+    g_awake_overflows = 0;
+    g_sleep_ticks = 0;
+    TCNT5 = 0;
+    g_clock_ms += ((uint32_t)ticks * POWER_AWAKE_TICK_US) / 1000;
+    sei();
+
+    // One overflow is 65536 * 4 us = 262.144 ms
+    awake_ms = (overflows * 262UL) + ((overflows * 144UL) / 1000) +
+               (((uint32_t)ticks * POWER_AWAKE_TICK_US) / 1000);
+    asleep_ms = sleep_ticks * POWER_WAKE_PERIOD_MS;
+
+    // Awake time in per mille
+    if (0 != (awake_ms + asleep_ms)) {
+        duty = (awake_ms * 1000UL) / (awake_ms + asleep_ms);
+    }
+
+    // Clear TXC0 so the end of the report can be detected below.
+    UCSR0A |= (1 << TXC0);
+
+    LOG("power: awake %lu ms, asleep %lu ms, avg %lu uA\n", awake_ms, asleep_ms,
+        ((duty * POWER_ACTIVE_UA) + ((1000 - duty) * POWER_DOWN_WDT_UA)) /
+            1000);
+
+    // Power-down stops the USART, let the last frame leave first.
+    while (!(UCSR0A & (1 << TXC0))) {
+        ;
+    }
+}
+
+/*
+ * Interrupt Service Routine for the watchdog, only enabled while asleep.
+ */
+ISR(WDT_vect)
+{
+    g_sleep_ticks++;
+    g_clock_ms += POWER_WAKE_PERIOD_MS;
+}
+
+/*
+ * Interrupt Service Routine for Timer 5 overflow, extends the awake counter.
+ */
+ISR(TIMER5_OVF_vect)
+{
+    g_awake_overflows++;
+    g_clock_ms += 262;
+}
+
+/*
+ * Wall clock since power_init(), awake and power-down time. Call with
+ * interrupts disabled.
+ *
+ * @param None
+ * @returns uint16_t milliseconds, wraps after 65 s
+ */
+uint16_t power_millis()
+{
+    uint16_t ticks = TCNT5;
+    uint16_t ms = g_clock_ms;
+
+    // Overflow not counted yet, the ISR waits for interrupts
+    if ((TIFR5 & (1 << TOV5)) && (0x8000 > ticks)) {
+        ms += 262;
+    }
+    return ms + (uint16_t)(((uint32_t)ticks * POWER_AWAKE_TICK_US) / 1000);
+}
+
+/*
+ EOF
+ */
@@ -0,0 +1,60 @@
+#ifndef _POWER_H
+#define _POWER_H
+
+#include <stdint.h>
+
+/*
+ * Armed idle sleeps in power-down and is woken by the watchdog interrupt.
+ * PIR (PE3) and REARM (PG5) are neither INTn nor PCINT pins on the 2560, so
+ * they are sampled on every watchdog wake instead.
+ *
+ * Worst case wake latency = watchdog period + oscillator start-up
+ * (16K CK = 1 ms with the full swing crystal fuses) = ~17 ms.
+ */
+#define POWER_WAKE_PERIOD_MS 16
+
+// Timer 5 runs only while the CPU is awake: prescaler 64 -> 4 us per tick.
+#define POWER_AWAKE_TICK_US 4
+
+// Typical supply current of the ATmega2560 at 5 V (datasheet chapter 31).
+#define POWER_ACTIVE_UA 14000
+#define POWER_DOWN_WDT_UA 10
+
+/*
+ * Shut down peripherals unused by the alarm via PRR0 / PRR1 and start the
+ * awake time counter.
+ *
+ * @param None
+ * @returns void
+ */
+void power_init();
+
+/*
+ * Sleep in power-down until the next watchdog wake. Caller polls its inputs
+ * after return.
+ *
+ * @param None
+ * @returns void
+ */
+void power_sleep_armed();
+
+/*
+ * Print time spent awake / asleep since previous report and an average
+ * current estimate over UART, then reset the counters.
+ *
+ * @param None
+ * @returns void
+ */
+void power_report();
+
+/*
+ * Wall clock since power_init(), awake and power-down time, whole ms lost
+ * to rounding at each sleep and report. Time stamp of recording traces,
+ * see TRACE_CLOCK_MS in trace.h. Call with interrupts disabled.
+ *
+ * @param None
+ * @returns uint16_t milliseconds, wraps after 65 s
+ */
+uint16_t power_millis();
+
+#endif // _POWER_H
@@ -57,14 +57,12 @@ Errors and omissions should be reported to codelibraries@exploreembedded.com
      unsigned int (0 to 65535)
          -----------------------------*/
 
-typedef signed char sint8_t;
-typedef unsigned char uint8_t;
+// Same widths as on the AVR when built for the host
+#include <stdint.h>
 
-typedef signed int sint16_t;
-typedef unsigned int uint16_t;
-
-typedef signed long int sint32_t;
-typedef unsigned long int uint32_t;
+typedef int8_t sint8_t;
+typedef int16_t sint16_t;
+typedef int32_t sint32_t;
 
 #define C_SINT8_MAX 0x7F
 #define C_SINT8_MIN -128
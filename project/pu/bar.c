@@ -0,0 +1,71 @@
+#include "bar.h"
+
+#include "hal.h"
+#include "lcd.h"
+
+// Glyphs with 1 - 5 columns filled from the left, blank top and bottom rows
+// keep adjacent lines apart.
+static const uint8_t g_bar_glyphs[BAR_CELL_COLUMNS][8] PROGMEM = {
+    {0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00},
+    {0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00},
+    {0x00, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x00},
+    {0x00, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x00},
+    {0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x00},
+};
+
+/*
+ * Load the bar glyphs into the LCD CGRAM, once after lcd_init().
+ *
+ * @param None
+ * @returns Void
+ */
+void bar_init()
+{
+    lcd_load_glyphs_p(BAR_GLYPH_FIRST, BAR_CELL_COLUMNS, &g_bar_glyphs[0][0]);
+}
+
+/*
+ * Draw a bar filled from the left in proportion to value / max.
+ *
+ * @param uint8_t x first cell
+ * @param uint8_t y line
+ * @param uint8_t width cells
+ * @param uint16_t value filled part, clipped to max
+ * @param uint16_t max value of a full bar
+ *
+ * @returns Void
+ */
+void bar_draw(uint8_t x, uint8_t y, uint8_t width, uint16_t value,
+              uint16_t max)
+{
+    uint16_t columns = 0;
+
+    if (value > max) {
+        value = max;
+    }
+    // Round to the nearest pixel column
+    if (0 != max) {
+        columns = (uint16_t)(((uint32_t)value * width * BAR_CELL_COLUMNS +
+                              (max / 2)) /
+                             max);
+    }
+
+    lcd_fb_gotoxy(x, y);
+    for (uint8_t cell = 0; width > cell; cell++) {
+        if (BAR_CELL_COLUMNS <= columns) {
+            lcd_fb_putc(BAR_GLYPH_FULL);
+            columns -= BAR_CELL_COLUMNS;
+        }
+        else if (0 != columns) {
+            lcd_fb_putc(BAR_GLYPH_FIRST + columns - 1);
+            columns = 0;
+        }
+        else {
+            lcd_fb_putc(' ');
+        }
+    }
+}
+
+/*
+ EOF
+ */
@@ -0,0 +1,43 @@
+#ifndef _BAR_H
+#define _BAR_H
+
+#include <stdint.h>
+
+/*
+ * Horizontal bar graph drawn into the LCD framebuffer. Each cell is split
+ * into 5 pixel columns with partly filled glyphs in CGRAM, a 16 cell bar
+ * has 80 steps. The framebuffer flush only writes the cells that changed,
+ * so a bar shrinking by less than a cell costs one or two cell writes.
+ */
+
+// Pixel columns per character cell
+#define BAR_CELL_COLUMNS 5
+
+// Character codes of the glyphs loaded by bar_init(), code n has n columns
+// filled. Code 0 is not used so bars can be part of a string.
+#define BAR_GLYPH_FIRST 1
+#define BAR_GLYPH_FULL (BAR_GLYPH_FIRST + BAR_CELL_COLUMNS - 1)
+
+/*
+ * Load the bar glyphs into the LCD CGRAM, once after lcd_init().
+ *
+ * @param None
+ * @returns Void
+ */
+void bar_init();
+
+/*
+ * Draw a bar filled from the left in proportion to value / max.
+ *
+ * @param uint8_t x first cell
+ * @param uint8_t y line
+ * @param uint8_t width cells
+ * @param uint16_t value filled part, clipped to max
+ * @param uint16_t max value of a full bar
+ *
+ * @returns Void
+ */
+void bar_draw(uint8_t x, uint8_t y, uint8_t width, uint16_t value,
+              uint16_t max);
+
+#endif // _BAR_H
@@ -0,0 +1,310 @@
+#include "buzzer.h"
+
+// Libs
+#include <avr/interrupt.h>
+
+#include "hal.h"
+#include "notes.h"
+#include "rtttl.h"
+#include "timer1.h"
+#include "timer2.h"
+
+// Low double beep and a pause, repeated until correct code
+static const buzzer_note_t g_wrong_code_melody[] PROGMEM = {
+    {TIMER1_NOTE_TOP(NOTE_C4), 150},
+    {BUZZER_REST, 100},
+    {TIMER1_NOTE_TOP(NOTE_C4), 150},
+    {BUZZER_REST, 800},
+    {0, 0},
+};
+
+// Rising chime played once when the system is rearmed
+static const buzzer_note_t g_armed_melody[] PROGMEM = {
+    {TIMER1_NOTE_TOP(NOTE_C5), 100},
+    {TIMER1_NOTE_TOP(NOTE_E5), 100},
+    {TIMER1_NOTE_TOP(NOTE_G5), 100},
+    {TIMER1_NOTE_TOP(NOTE_C6), 250},
+    {0, 0},
+};
+
+// Siren sweep shape, raised cosine 0 (low pitch) - 255 (high pitch)
+static const uint8_t g_siren_sweep[64] PROGMEM = {
+    0,   1,   2,   5,   10,  15,  21,  29,  37,  47,  57,  67,  79,
+    90,  103, 115, 127, 140, 152, 165, 176, 188, 198, 208, 218, 226,
+    234, 240, 245, 250, 253, 254, 255, 254, 253, 250, 245, 240, 234,
+    226, 218, 208, 198, 188, 176, 165, 152, 140, 128, 115, 103, 90,
+    79,  67,  57,  47,  37,  29,  21,  15,  10,  5,   2,   1,
+};
+
+// Siren phase accumulator, top 6 bits index g_siren_sweep
+static uint16_t g_siren_phase = 0;
+static uint16_t g_siren_step = 0;
+static uint16_t g_siren_low = 0;
+static uint16_t g_siren_span = 0;
+static uint8_t g_is_siren = 0;
+
+// Melody start and current step, both point to flash
+static const buzzer_note_t *g_first = 0;
+static const buzzer_note_t *g_current = 0;
+
+// RTTTL tune decoder, used instead of the table when g_is_rtttl is set
+static rtttl_t g_tune;
+static uint8_t g_is_rtttl = 0;
+
+// Milliseconds left of the current step
+static volatile uint16_t g_remaining_ms = 0;
+
+// Restart the melody after the last step
+static uint8_t g_repeat = 0;
+
+// Byte readers for the RTTTL decoder
+static uint8_t buzzer_read_flash(const char *addr)
+{
+    return pgm_read_byte(addr);
+}
+
+static uint8_t buzzer_read_eeprom(const char *addr)
+{
+    return hal_eeprom_read((const uint8_t *)addr);
+}
+
+/*
+ * Fetch the next step from the table or the tune, 0 at the end.
+ */
+static uint8_t buzzer_fetch_step(uint16_t *top, uint16_t *ms)
+{
+    if (g_is_rtttl) {
+        return rtttl_next(&g_tune, top, ms);
+    }
+
+    *top = pgm_read_word(&g_current->top);
+    *ms = pgm_read_word(&g_current->ms);
+    g_current++;
+    return 0 != *ms;
+}
+
+/*
+ * Load the next step, wrapping or stopping at the end.
+ * Called when playback starts and from the timer 2 interrupt.
+ * Returns 0 if playback stopped.
+ */
+static uint8_t buzzer_load_step()
+{
+    uint16_t top;
+    uint16_t ms;
+
+    if (!buzzer_fetch_step(&top, &ms)) {
+        if (g_repeat) {
+            if (g_is_rtttl) {
+                rtttl_rewind(&g_tune);
+            }
+            g_current = g_first;
+        }
+        // Not repeated or nothing to play at all
+        if (!g_repeat || !buzzer_fetch_step(&top, &ms)) {
+            buzzer_stop();
+            return 0;
+        }
+    }
+
+    // Rest keeps timer 1 running with the pin disconnected
+    if (BUZZER_REST == top) {
+        timer1_set_output(0);
+    }
+    else {
+        timer1_set_target(top);
+        timer1_set_output(1);
+    }
+    g_remaining_ms = ms;
+    return 1;
+}
+
+/*
+ * Start the millisecond tick of timer 2, enables interrupts.
+ */
+static void buzzer_start_tick()
+{
+#ifdef BUZZER_ISR_PROBE
+    DDRB |= (1 << PB0);
+#endif
+    timer2_init_ctc_ms();
+}
+
+/*
+ * Start timers 1 and 2 on the first step of the selected melody.
+ */
+static void buzzer_start()
+{
+    // Initialize timer 1 PWM mode, tone is set by the first step
+    timer1_init_mode_9();
+    if (!buzzer_load_step()) {
+        return;
+    }
+    timer1_set_prescaler(TIMER1_NOTE_PS);
+
+    // Millisecond tick for step durations
+    buzzer_start_tick();
+}
+
+/*
+ * Start playing a melody in the background, replaces the one playing.
+ * Alarm and wrong code repeat until buzzer_stop(), armed plays once.
+ *
+ * @param uint8_t melody BUZZER_ALARM, BUZZER_WRONG_CODE or BUZZER_ARMED
+ * @returns Void
+ */
+void buzzer_play(uint8_t melody)
+{
+    const buzzer_note_t *first;
+    uint8_t repeat = 1;
+
+    switch (melody) {
+    case BUZZER_ALARM:
+        // Installers can replace the siren with a tune in EEPROM
+        if (0 != buzzer_play_rtttl(BUZZER_EEPROM_ALARM, BUZZER_EEPROM, 1)) {
+            buzzer_siren(BUZZER_SIREN_LOW_TOP, BUZZER_SIREN_HIGH_TOP,
+                         BUZZER_SIREN_PERIOD_MS);
+        }
+        return;
+    case BUZZER_WRONG_CODE:
+        first = g_wrong_code_melody;
+        break;
+    case BUZZER_ARMED:
+        first = g_armed_melody;
+        repeat = 0;
+        break;
+    default:
+        return;
+    }
+
+    // Stop the step tick while the melody is swapped
+    timer2_clear();
+    g_is_siren = 0;
+    g_is_rtttl = 0;
+    g_first = first;
+    g_current = first;
+    g_repeat = repeat;
+
+    buzzer_start();
+}
+
+/*
+ * Start playing an RTTTL tune in the background, decoded one note at a time.
+ *
+ * @param const char *tune address of the tune in flash or EEPROM
+ * @param uint8_t source BUZZER_FLASH or BUZZER_EEPROM
+ * @param uint8_t repeat 1 to repeat until buzzer_stop()
+ *
+ * @returns uint8_t 0 for success, 1 if there is no valid tune at the address
+ */
+uint8_t buzzer_play_rtttl(const char *tune, uint8_t source, uint8_t repeat)
+{
+    rtttl_t opened;
+
+    if (rtttl_open(&opened, tune,
+                   (BUZZER_EEPROM == source) ? buzzer_read_eeprom
+                                             : buzzer_read_flash)) {
+        return 1;
+    }
+
+    // Stop the step tick while the melody is swapped
+    timer2_clear();
+    g_tune = opened;
+    g_is_siren = 0;
+    g_is_rtttl = 1;
+    g_repeat = repeat;
+
+    buzzer_start();
+    return 0;
+}
+
+/*
+ * Start a siren in the background, sweeping timer 1 TOP from low_top to
+ * high_top and back once per period. The sweep follows a raised cosine table
+ * in flash indexed by a 16 bit phase accumulator advanced every millisecond.
+ *
+ * @param uint16_t low_top TOP value of the lowest pitch
+ * @param uint16_t high_top TOP value of the highest pitch, below low_top
+ * @param uint16_t period_ms duration of one sweep up and down, 2 - 65535 ms
+ *
+ * @returns Void
+ */
+void buzzer_siren(uint16_t low_top, uint16_t high_top, uint16_t period_ms)
+{
+    // Stop the step tick while the melody is swapped
+    timer2_clear();
+
+    if (high_top > low_top) {
+        high_top = low_top;
+    }
+    if (2 > period_ms) {
+        period_ms = 2;
+    }
+
+    // One phase wrap (65536) per period, one step per millisecond. Division
+    // happens here once, the interrupt only adds.
+    g_siren_step = (uint16_t)(65536UL / period_ms);
+    g_siren_phase = 0;
+    g_siren_low = low_top;
+    g_siren_span = low_top - high_top;
+    g_is_rtttl = 0;
+    g_is_siren = 1;
+
+    timer1_init_mode_9();
+    timer1_set_target(low_top);
+    timer1_set_output(1);
+    timer1_set_prescaler(TIMER1_NOTE_PS);
+
+    // Millisecond tick for the sweep
+    buzzer_start_tick();
+}
+
+/*
+ * Stop playing and release timers 1 and 2.
+ *
+ * @param None
+ * @returns Void
+ */
+void buzzer_stop()
+{
+    timer2_clear();
+    timer1_clear();
+    g_remaining_ms = 0;
+}
+
+/*
+ * Interrupt Service Routine for timer 2, advances the melody.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+#ifdef BUZZER_ISR_PROBE
+    PORTB |= (1 << PB0);
+#endif
+
+    // Siren: constant cost, one add, one flash read, two 8x8 multiplies.
+    // TOP is interpolated linearly between the limits.
+    if (g_is_siren) {
+        uint8_t span_hi = g_siren_span >> 8;
+        uint8_t span_lo = (uint8_t)g_siren_span;
+        uint8_t level;
+
+        g_siren_phase += g_siren_step;
+        level = pgm_read_byte(&g_siren_sweep[g_siren_phase >> 10]);
+
+        // span * level / 256 as two 8x8 MULs on the span bytes, exact. A
+        // 32-bit product would call __mulsi3.
+        timer1_set_target(g_siren_low - ((uint16_t)span_hi * level) -
+                          (((uint16_t)span_lo * level) >> 8));
+    }
+    else if ((0 != g_remaining_ms) && (0 == --g_remaining_ms)) {
+        buzzer_load_step();
+    }
+
+#ifdef BUZZER_ISR_PROBE
+    PORTB &= ~(1 << PB0);
+#endif
+}
+
+/*
+ EOF
+ */
@@ -0,0 +1,93 @@
+#ifndef _BUZZER_H
+#define _BUZZER_H
+
+#include <stdint.h>
+
+#include "notes.h"
+#include "timer1.h"
+
+// Melodies known by buzzer_play()
+#define BUZZER_ALARM 0
+#define BUZZER_WRONG_CODE 1
+#define BUZZER_ARMED 2
+
+// TOP value 0 in a melody is a rest, duration 0 ends the melody.
+#define BUZZER_REST 0
+
+// Where buzzer_play_rtttl() reads the tune from
+#define BUZZER_FLASH 0
+#define BUZZER_EEPROM 1
+
+/*
+ * Default alarm siren: sweeps between the two notes and back once per period.
+ * TOP values come from TIMER1_NOTE_TOP(), the larger TOP is the lower pitch.
+ */
+#define BUZZER_SIREN_LOW_TOP TIMER1_NOTE_TOP(NOTE_D5)
+#define BUZZER_SIREN_HIGH_TOP TIMER1_NOTE_TOP(NOTE_D6)
+#define BUZZER_SIREN_PERIOD_MS 2000
+
+/*
+ * Compile with -DBUZZER_ISR_PROBE to drive PB0 high for the duration of the
+ * timer 2 interrupt, so its cost can be read from a simulator trace or a
+ * logic analyzer.
+ */
+
+/*
+ * An RTTTL tune stored at the start of EEPROM replaces the built in alarm,
+ * see the eeprom_tune target in the Makefile.
+ */
+#define BUZZER_EEPROM_ALARM ((const char *)0)
+
+/*
+ * One step of a melody stored in PROGMEM.
+ * top: timer 1 TOP value, see TIMER1_NOTE_TOP()
+ * ms: duration of the step in milliseconds
+ */
+typedef struct {
+    uint16_t top;
+    uint16_t ms;
+} buzzer_note_t;
+
+/*
+ * Start playing a melody in the background, replaces the one playing.
+ * Alarm and wrong code repeat until buzzer_stop(), armed plays once.
+ * Alarm is the siren unless an RTTTL tune is stored in EEPROM.
+ *
+ * @param uint8_t melody BUZZER_ALARM, BUZZER_WRONG_CODE or BUZZER_ARMED
+ * @returns Void
+ */
+void buzzer_play(uint8_t melody);
+
+/*
+ * Start playing an RTTTL tune in the background, decoded one note at a time.
+ *
+ * @param const char *tune address of the tune in flash or EEPROM
+ * @param uint8_t source BUZZER_FLASH or BUZZER_EEPROM
+ * @param uint8_t repeat 1 to repeat until buzzer_stop()
+ *
+ * @returns uint8_t 0 for success, 1 if there is no valid tune at the address
+ */
+uint8_t buzzer_play_rtttl(const char *tune, uint8_t source, uint8_t repeat);
+
+/*
+ * Start a siren in the background, sweeping timer 1 TOP from low_top to
+ * high_top and back once per period. The sweep follows a raised cosine table
+ * in flash indexed by a 16 bit phase accumulator advanced every millisecond.
+ *
+ * @param uint16_t low_top TOP value of the lowest pitch
+ * @param uint16_t high_top TOP value of the highest pitch, below low_top
+ * @param uint16_t period_ms duration of one sweep up and down, 2 - 65535 ms
+ *
+ * @returns Void
+ */
+void buzzer_siren(uint16_t low_top, uint16_t high_top, uint16_t period_ms);
+
+/*
+ * Stop playing and release timers 1 and 2.
+ *
+ * @param None
+ * @returns Void
+ */
+void buzzer_stop();
+
+#endif // _BUZZER_H
@@ -0,0 +1,123 @@
+#include "countdown.h"
+
+#include "bar.h"
+#include "power.h"
+#include "protocol.h"
+#include "screen.h"
+#include "trace.h"
+
+// Longest countdown, milliseconds have to fit 16 bits
+#define COUNTDOWN_MAX_S 60
+
+// Countdown states
+#define COUNTDOWN_STOPPED 0
+#define COUNTDOWN_SHOWN 1
+#define COUNTDOWN_HIDDEN 2
+
+static uint8_t g_state = COUNTDOWN_STOPPED;
+
+// Time left and whole countdown, total 0 if the Mega did not tell
+static uint16_t g_left_ms = 0;
+static uint16_t g_total_ms = 0;
+
+// Watchdog tick count when g_left_ms was last updated
+static uint8_t g_last_tick = 0;
+
+/*
+ * Start the countdown or resync it to the Mega and show it again.
+ *
+ * @param uint8_t remaining seconds left
+ * @param uint8_t total seconds of the whole countdown, 0 if not known
+ *
+ * @returns Void
+ */
+void countdown_start(uint8_t remaining, uint8_t total)
+{
+    if (COUNTDOWN_MAX_S < total) {
+        total = COUNTDOWN_MAX_S;
+    }
+    if (total < remaining) {
+        remaining = total;
+    }
+
+    g_left_ms = remaining * 1000U;
+    g_total_ms = total * 1000U;
+
+    // Count whole ticks from the Mega's second on
+    power_tick_restart();
+    g_last_tick = power_ticks();
+    g_state = COUNTDOWN_SHOWN;
+}
+
+/*
+ * Stop the countdown.
+ *
+ * @param None
+ * @returns Void
+ */
+void countdown_stop() { g_state = COUNTDOWN_STOPPED; }
+
+/*
+ * Keep counting but leave the display to another screen until the next
+ * resync.
+ *
+ * @param None
+ * @returns Void
+ */
+void countdown_hide()
+{
+    if (COUNTDOWN_SHOWN == g_state) {
+        g_state = COUNTDOWN_HIDDEN;
+    }
+}
+
+/*
+ * Check if the display should move on, the main loop wakes up for this.
+ *
+ * @param None
+ * @returns uint8_t 1 if a watchdog tick passed while the countdown is shown
+ */
+uint8_t countdown_pending()
+{
+    return (COUNTDOWN_SHOWN == g_state) && (0 != g_total_ms) &&
+           (power_ticks() != g_last_tick);
+}
+
+/*
+ * Count the watchdog ticks passed and draw the countdown into the
+ * framebuffer. Seconds are rounded up, 0 s shows only when time is up.
+ *
+ * @param None
+ * @returns uint8_t 1 if drawn, 0 if stopped or hidden
+ */
+uint8_t countdown_update()
+{
+    uint8_t now = power_ticks();
+    uint16_t elapsed_ms = (uint8_t)(now - g_last_tick) * POWER_TICK_MS;
+    uint8_t seconds[2];
+
+    g_last_tick = now;
+    g_left_ms = (elapsed_ms < g_left_ms) ? g_left_ms - elapsed_ms : 0;
+
+    if (COUNTDOWN_SHOWN != g_state) {
+        return 0;
+    }
+
+    // Movement without a time yet, full bar
+    if (0 == g_total_ms) {
+        screen_draw(SCREEN_MOVEMENT, 0, 0);
+        bar_draw(0, 1, COUNTDOWN_BAR_WIDTH, 1, 1);
+        return 1;
+    }
+
+    seconds[0] = PARAM_SECONDS;
+    seconds[1] = (g_left_ms + 999U) / 1000U;
+    TRACE(TRACE_COUNTDOWN, seconds[1], 0);
+    screen_draw(SCREEN_COUNTDOWN, seconds, sizeof(seconds));
+    bar_draw(0, 1, COUNTDOWN_BAR_WIDTH, g_left_ms, g_total_ms);
+    return 1;
+}
+
+/*
+ EOF
+ */
@@ -0,0 +1,64 @@
+#ifndef _COUNTDOWN_H
+#define _COUNTDOWN_H
+
+#include <stdint.h>
+
+/*
+ * Alarm countdown kept by the UNO itself. The Mega sends the seconds left
+ * when the countdown starts and every few seconds after, in between the
+ * watchdog tick moves the display on: seconds left and a bar on line 1.
+ *
+ * The watchdog oscillator is only accurate to about 10 %. Each resync
+ * restarts the watchdog period, so the n-th tick after it is n * 25 ms off
+ * at worst. With a resync every 2 s that is at most 8 ticks ahead (200 ms)
+ * or 7 ticks behind (175 ms), below one display refresh (250 ms).
+ */
+
+// Countdown bar on line 1
+#define COUNTDOWN_BAR_WIDTH 11
+
+/*
+ * Start the countdown or resync it to the Mega and show it again.
+ *
+ * @param uint8_t remaining seconds left
+ * @param uint8_t total seconds of the whole countdown, 0 if not known
+ *
+ * @returns Void
+ */
+void countdown_start(uint8_t remaining, uint8_t total);
+
+/*
+ * Stop the countdown.
+ *
+ * @param None
+ * @returns Void
+ */
+void countdown_stop();
+
+/*
+ * Keep counting but leave the display to another screen until the next
+ * resync.
+ *
+ * @param None
+ * @returns Void
+ */
+void countdown_hide();
+
+/*
+ * Check if the display should move on, the main loop wakes up for this.
+ *
+ * @param None
+ * @returns uint8_t 1 if a watchdog tick passed while the countdown is shown
+ */
+uint8_t countdown_pending();
+
+/*
+ * Count the watchdog ticks passed and draw the countdown into the
+ * framebuffer.
+ *
+ * @param None
+ * @returns uint8_t 1 if drawn, 0 if stopped or hidden
+ */
+uint8_t countdown_update();
+
+#endif // _COUNTDOWN_H
@@ -0,0 +1,161 @@
+#include "hal.h"
+
+// Libs
+#include <stdio.h>
+
+#include "uart.h"
+
+/*
+ * AVR backend of the UNO: TWI slave receiver and UART. GPIO and EEPROM are
+ * inline in hal.h.
+ */
+
+// TWI address match or data, wakes the CPU. Interrupt is disabled until the
+// main loop has received the frame, TWINT stays set and holds the bus.
+ISR(TWI_vect) { TWCR &= ~((1 << TWIE) | (1 << TWINT)); }
+
+// TWINT polls before a TWI wait gives up, about 10 ms at 16 MHz. The Mega
+// sends a byte every 23 us once it has the address acknowledged.
+#define TWI_WAIT_POLLS 20000U
+
+/*
+ * Wait for TWINT, at most TWI_WAIT_POLLS polls.
+ *
+ * @param None
+ * @returns uint8_t TWSR & 0xF8, 0xF8 (no state) on timeout
+ */
+static uint8_t twi_wait()
+{
+    for (uint16_t polls = TWI_WAIT_POLLS; polls; polls--) {
+        if (TWCR & (1 << TWINT)) {
+            return TWSR & 0xF8;
+        }
+    }
+    return 0xF8;
+}
+
+/*
+ * Function to setup device as slave receiver.
+ *
+ * Follows closely Atmel Mega 2560 document of which page 253 - 254 contain
+ * relevant information. Figure 24-15.
+ */
+void hal_twi_slave_init(uint8_t address)
+{
+    // Devices own Slave Address
+    TWAR = address;
+
+    // Slave receiver mode setup, interrupt wakes the CPU from sleep on
+    // address match.
+    TWCR |= (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+
+    // Explicitly set to 0
+    TWCR &= ~(1 << TWSTA) & ~(1 << TWSTO);
+    // Eqv: TWCR = 0b01000100;
+}
+
+/*
+ * Address match, TWINT stays set until the frame is read.
+ *
+ * @param None
+ * @returns uint8_t non zero if hal_twi_read() has a frame
+ */
+uint8_t hal_twi_pending() { return TWCR & (1 << TWINT); }
+
+/*
+ Function to receive data from Master, returns the number of bytes received.
+ Frames are binary, the end is the STOP condition or the byte that fills the
+ buffer: that one is not acknowledged, the Mega stops sending and the TWI is
+ no longer addressed, its STOP is not reported. A frame cut short by a bus
+ error or a wait of TWI_WAIT_POLLS is dropped, 0 is returned and the TWI is
+ reset to listen again.
+ */
+uint8_t hal_twi_read(uint8_t *received, uint8_t size)
+{
+    uint8_t twi_stat = 0;
+    uint8_t twi_idx = 0;
+
+    // Waiting for TWINT to set:
+    twi_stat = twi_wait();
+
+    // Make sure the received array is full of nulls
+    for (uint8_t idx = 0; size > idx; idx++) {
+        received[idx] = 0;
+    }
+
+    // HEX values can be found in atmega 2560 doc page: 255, table: 24-4
+    // Address or general call match, then data with ACK returned, while
+    // the buffer has room
+    while (((0x60 == twi_stat) || (0x70 == twi_stat) || (0x80 == twi_stat) ||
+            (0x90 == twi_stat)) &&
+           (size > twi_idx)) {
+        if ((0x80 == twi_stat) || (0x90 == twi_stat)) {
+            received[twi_idx] = TWDR;
+            twi_idx++;
+        }
+
+        // ACK the next byte, NACK it if it is the last one that fits
+        if (size > twi_idx + 1) {
+            TWCR |= (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
+        }
+        else {
+            TWCR = (TWCR & ~(1 << TWEA)) | (1 << TWINT) | (1 << TWEN);
+        }
+
+        // Status update
+        twi_stat = twi_wait();
+    }
+
+    // Last byte, not acknowledged: back to listening for the own address
+    if (((0x88 == twi_stat) || (0x98 == twi_stat)) && (size > twi_idx)) {
+        received[twi_idx] = TWDR;
+        twi_idx++;
+        TWCR |= (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
+    }
+
+    // STOP signal or repeated start signal
+    else if ((0xA0 == twi_stat)) {
+        TWCR |= (1 << TWINT) | (1 << TWEA);
+    }
+
+    // Bus error, STOP releases the lines
+    else if ((0x00 == twi_stat)) {
+        TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEA) | (1 << TWEN);
+        twi_idx = 0;
+    }
+
+    // Timeout, the Mega left in the middle of the frame: TWI off lets SCL
+    // and SDA go
+    else {
+        TWCR = 0;
+        TWCR = (1 << TWEA) | (1 << TWEN);
+        twi_idx = 0;
+    }
+
+    return twi_idx;
+}
+
+/*
+ * Wake up again on next address match.
+ *
+ * @param None
+ * @returns void
+ */
+void hal_twi_listen() { TWCR = (TWCR & ~(1 << TWINT)) | (1 << TWIE); }
+
+/*
+ * Initialize USART0 and point stdin and stdout to it.
+ *
+ * @param uint16_t ubrr baud rate register value
+ * @returns void
+ */
+void hal_uart_init(uint16_t ubrr)
+{
+    usart_init(ubrr);
+    stdin = &mystdin;
+    stdout = &mystdout;
+}
+
+/*
+ EOF
+ */
@@ -23,6 +23,7 @@
 
 *****************************************************************************/
 #include "lcd.h"
+#include <avr/interrupt.h>
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #include <inttypes.h>
@@ -48,6 +49,26 @@
 #define lcd_rw_low() LCD_RW_PORT &= ~_BV(LCD_RW_PIN)
 #define lcd_rs_high() LCD_RS_PORT |= _BV(LCD_RS_PIN)
 #define lcd_rs_low() LCD_RS_PORT &= ~_BV(LCD_RS_PIN)
+
+/*
+** data line layout, resolved at compile time
+** D4..D7 on four consecutive bits of one port (e.g. PD4..PD7 or PB0..PB3)
+** are written with one read-modify-write of the port, the nibble is moved
+** into place by a constant shift (swap for the upper nibble). Any other
+** wiring sets or clears each line on its own.
+*/
+#if (LCD_DATA1_PIN == LCD_DATA0_PIN + 1) &&                                    \
+    (LCD_DATA2_PIN == LCD_DATA0_PIN + 2) &&                                    \
+    (LCD_DATA3_PIN == LCD_DATA0_PIN + 3)
+#define LCD_DATA_CONSECUTIVE 1
+#else
+#define LCD_DATA_CONSECUTIVE 0
+#endif
+#define LCD_DATA_MASK ((uint8_t)(0x0F << LCD_DATA0_PIN))
+#define LCD_DATA_NIBBLE                                                        \
+    (LCD_DATA_CONSECUTIVE && (&LCD_DATA0_PORT == &LCD_DATA1_PORT) &&          \
+     (&LCD_DATA1_PORT == &LCD_DATA2_PORT) &&                                   \
+     (&LCD_DATA2_PORT == &LCD_DATA3_PORT))
 #endif
 
 #if LCD_IO_MODE
@@ -76,6 +97,35 @@
 #endif
 #endif
 
+#if LCD_ASYNC
+/* queue entry: bits 0..3 nibble, RS level, wait for clear / home after it */
+/* or a pause: LCD_Q_DELAY and bits 0..6 milli seconds, nothing is written */
+#define LCD_Q_RS 0x10
+#define LCD_Q_WAIT_CLEAR 0x20
+#define LCD_Q_DELAY 0x80
+#define LCD_Q_MASK (LCD_QUEUE_SIZE - 1)
+#define LCD_Q_CLEAR_TICKS (LCD_DELAY_CLEAR / LCD_QUEUE_TICK_US)
+#define LCD_Q_MS_TICKS (1000 / LCD_QUEUE_TICK_US)
+
+/* timer 0 CTC, prescaler 8: 2 counts per micro second at 16 MHz */
+#define LCD_Q_TIMER_PS ((1 << CS01))
+#define LCD_Q_TIMER_TOP ((F_CPU / 8 / 1000000UL) * LCD_QUEUE_TICK_US - 1)
+
+static volatile uint8_t lcd_q_buf[LCD_QUEUE_SIZE];
+static volatile uint8_t lcd_q_head; /* written by caller    */
+static volatile uint8_t lcd_q_tail; /* written by interrupt */
+static volatile uint16_t lcd_q_wait; /* ticks left to wait  */
+static uint8_t lcd_addr;            /* DDRAM address counter kept in software */
+#endif
+
+/*
+** framebuffer: what should be shown and what the display shows
+*/
+static char lcd_frame[LCD_LINES][LCD_DISP_LENGTH];
+static char lcd_shadow[LCD_LINES][LCD_DISP_LENGTH];
+static uint8_t lcd_frame_x;
+static uint8_t lcd_frame_y;
+
 /*
 ** function prototypes
 */
@@ -111,10 +161,125 @@ Input:    data   byte to write to LCD
 Returns:  none
 *************************************************************************/
 #if LCD_IO_MODE
+/*************************************************************************
+Low-level function to put a nibble on the four data lines
+Input:    nibble bits 0..3 to output on D4..D7
+Returns:  none
+*************************************************************************/
+static inline void lcd_nibble_out(uint8_t nibble)
+{
+    if (LCD_DATA_NIBBLE) {
+        /* shift by 0 or 4 costs nothing or one swap */
+        LCD_DATA0_PORT = (LCD_DATA0_PORT & ~LCD_DATA_MASK) |
+                         ((uint8_t)(nibble << LCD_DATA0_PIN) & LCD_DATA_MASK);
+    }
+    else {
+        /* one sbi or cbi per line, no lines go low in between */
+        if (nibble & 0x08)
+            LCD_DATA3_PORT |= _BV(LCD_DATA3_PIN);
+        else
+            LCD_DATA3_PORT &= ~_BV(LCD_DATA3_PIN);
+        if (nibble & 0x04)
+            LCD_DATA2_PORT |= _BV(LCD_DATA2_PIN);
+        else
+            LCD_DATA2_PORT &= ~_BV(LCD_DATA2_PIN);
+        if (nibble & 0x02)
+            LCD_DATA1_PORT |= _BV(LCD_DATA1_PIN);
+        else
+            LCD_DATA1_PORT &= ~_BV(LCD_DATA1_PIN);
+        if (nibble & 0x01)
+            LCD_DATA0_PORT |= _BV(LCD_DATA0_PIN);
+        else
+            LCD_DATA0_PORT &= ~_BV(LCD_DATA0_PIN);
+    }
+}
+
+/*************************************************************************
+configure the four data lines as output
+*************************************************************************/
+static inline void lcd_data_out_dir(void)
+{
+    if (LCD_DATA_NIBBLE) {
+        DDR(LCD_DATA0_PORT) |= LCD_DATA_MASK;
+    }
+    else {
+        DDR(LCD_DATA0_PORT) |= _BV(LCD_DATA0_PIN);
+        DDR(LCD_DATA1_PORT) |= _BV(LCD_DATA1_PIN);
+        DDR(LCD_DATA2_PORT) |= _BV(LCD_DATA2_PIN);
+        DDR(LCD_DATA3_PORT) |= _BV(LCD_DATA3_PIN);
+    }
+}
+#endif
+
+#if LCD_IO_MODE && LCD_ASYNC
+/*************************************************************************
+Append one nibble op to the queue, waits only while the queue is full
+*************************************************************************/
+static void lcd_q_put(uint8_t op)
+{
+    uint8_t next = (lcd_q_head + 1) & LCD_Q_MASK;
+
+    while (next == lcd_q_tail) {
+        /* queue full, interrupt makes room */
+    }
+    lcd_q_buf[lcd_q_head] = op;
+    lcd_q_head = next;
+}
+
+/*************************************************************************
+Start timer 0 if the queue had drained, the interrupt stops the timer
+when it finds the queue empty
+*************************************************************************/
+static void lcd_q_start(void)
+{
+    if (!(TCCR0B & LCD_Q_TIMER_PS)) {
+        /* power_init() may have shut timer 0 down since lcd_init() */
+        PRR &= ~_BV(PRTIM0);
+        TCNT0 = 0;
+        TCCR0B = LCD_Q_TIMER_PS;
+    }
+}
+
+/*************************************************************************
+Queue a pause, rounded up to milli seconds, at most 127 ms
+*************************************************************************/
+static void lcd_q_delay(uint16_t us)
+{
+    lcd_q_put(LCD_Q_DELAY | (uint8_t)((us + 999) / 1000));
+}
+
+/*************************************************************************
+Queue a byte for the LCD controller as two nibble writes, high nibble
+first. Starts timer 0 if the queue had drained. The software address
+counter follows the write.
+Input:    data   byte to write to LCD
+          rs     1: write data
+                 0: write instruction
+Returns:  none
+*************************************************************************/
 static void lcd_write(uint8_t data, uint8_t rs)
 {
-    unsigned char dataBits;
+    uint8_t flags = rs ? LCD_Q_RS : 0;
 
+    if (rs) {
+        lcd_addr++;
+    }
+    else if (data & (1 << LCD_DDRAM)) {
+        lcd_addr = data & ~(1 << LCD_DDRAM);
+    }
+    else if (data < (1 << LCD_ENTRY_MODE)) {
+        /* clear display or return home, long execution time */
+        lcd_addr = 0;
+        flags |= LCD_Q_WAIT_CLEAR;
+    }
+
+    lcd_q_put(((data >> 4) & 0x0F) | (flags & LCD_Q_RS));
+    lcd_q_put((data & 0x0F) | flags);
+    lcd_q_start();
+}
+#elif LCD_IO_MODE
+static void lcd_write(uint8_t data, uint8_t rs)
+{
     if (rs) { /* write data        (RS=1, RW=0) */
         lcd_rs_high();
     }
@@ -123,68 +288,19 @@ static void lcd_write(uint8_t data, uint8_t rs)
     }
     lcd_rw_low(); /* RW=0  write mode      */
 
-    if ((&LCD_DATA0_PORT == &LCD_DATA1_PORT) &&
-        (&LCD_DATA1_PORT == &LCD_DATA2_PORT) &&
-        (&LCD_DATA2_PORT == &LCD_DATA3_PORT) && (LCD_DATA0_PIN == 0) &&
-        (LCD_DATA1_PIN == 1) && (LCD_DATA2_PIN == 2) && (LCD_DATA3_PIN == 3)) {
-        /* configure data pins as output */
-        DDR(LCD_DATA0_PORT) |= 0x0F;
-
-        /* output high nibble first */
-        dataBits = LCD_DATA0_PORT & 0xF0;
-        LCD_DATA0_PORT = dataBits | ((data >> 4) & 0x0F);
-        lcd_e_toggle();
-
-        /* output low nibble */
-        LCD_DATA0_PORT = dataBits | (data & 0x0F);
-        lcd_e_toggle();
+    /* configure data pins as output */
+    lcd_data_out_dir();
 
-        /* all data pins high (inactive) */
-        LCD_DATA0_PORT = dataBits | 0x0F;
-    }
-    else {
-        /* configure data pins as output */
-        DDR(LCD_DATA0_PORT) |= _BV(LCD_DATA0_PIN);
-        DDR(LCD_DATA1_PORT) |= _BV(LCD_DATA1_PIN);
-        DDR(LCD_DATA2_PORT) |= _BV(LCD_DATA2_PIN);
-        DDR(LCD_DATA3_PORT) |= _BV(LCD_DATA3_PIN);
+    /* output high nibble first */
+    lcd_nibble_out(data >> 4);
+    lcd_e_toggle();
 
-        /* output high nibble first */
-        LCD_DATA3_PORT &= ~_BV(LCD_DATA3_PIN);
-        LCD_DATA2_PORT &= ~_BV(LCD_DATA2_PIN);
-        LCD_DATA1_PORT &= ~_BV(LCD_DATA1_PIN);
-        LCD_DATA0_PORT &= ~_BV(LCD_DATA0_PIN);
-        if (data & 0x80)
-            LCD_DATA3_PORT |= _BV(LCD_DATA3_PIN);
-        if (data & 0x40)
-            LCD_DATA2_PORT |= _BV(LCD_DATA2_PIN);
-        if (data & 0x20)
-            LCD_DATA1_PORT |= _BV(LCD_DATA1_PIN);
-        if (data & 0x10)
-            LCD_DATA0_PORT |= _BV(LCD_DATA0_PIN);
-        lcd_e_toggle();
-
-        /* output low nibble */
-        LCD_DATA3_PORT &= ~_BV(LCD_DATA3_PIN);
-        LCD_DATA2_PORT &= ~_BV(LCD_DATA2_PIN);
-        LCD_DATA1_PORT &= ~_BV(LCD_DATA1_PIN);
-        LCD_DATA0_PORT &= ~_BV(LCD_DATA0_PIN);
-        if (data & 0x08)
-            LCD_DATA3_PORT |= _BV(LCD_DATA3_PIN);
-        if (data & 0x04)
-            LCD_DATA2_PORT |= _BV(LCD_DATA2_PIN);
-        if (data & 0x02)
-            LCD_DATA1_PORT |= _BV(LCD_DATA1_PIN);
-        if (data & 0x01)
-            LCD_DATA0_PORT |= _BV(LCD_DATA0_PIN);
-        lcd_e_toggle();
+    /* output low nibble */
+    lcd_nibble_out(data);
+    lcd_e_toggle();
 
-        /* all data pins high (inactive) */
-        LCD_DATA0_PORT |= _BV(LCD_DATA0_PIN);
-        LCD_DATA1_PORT |= _BV(LCD_DATA1_PIN);
-        LCD_DATA2_PORT |= _BV(LCD_DATA2_PIN);
-        LCD_DATA3_PORT |= _BV(LCD_DATA3_PIN);
-    }
+    /* all data pins high (inactive) */
+    lcd_nibble_out(0x0F);
 }
 #else
 #define lcd_write(d, rs)                                                       \
@@ -202,7 +318,9 @@ Input:    rs     1: read data
                  0: read busy flag / address counter
 Returns:  byte read from LCD controller
 *************************************************************************/
-#if LCD_IO_MODE
+#if LCD_IO_MODE && LCD_ASYNC
+/* busy flag is never read, R/W stays low */
+#elif LCD_IO_MODE
 static uint8_t lcd_read(uint8_t rs)
 {
     uint8_t data;
@@ -213,22 +331,24 @@ static uint8_t lcd_read(uint8_t rs)
         lcd_rs_low(); /* RS=0: read busy flag */
     lcd_rw_high();    /* RW=1  read mode      */
 
-    if ((&LCD_DATA0_PORT == &LCD_DATA1_PORT) &&
-        (&LCD_DATA1_PORT == &LCD_DATA2_PORT) &&
-        (&LCD_DATA2_PORT == &LCD_DATA3_PORT) && (LCD_DATA0_PIN == 0) &&
-        (LCD_DATA1_PIN == 1) && (LCD_DATA2_PIN == 2) && (LCD_DATA3_PIN == 3)) {
-        DDR(LCD_DATA0_PORT) &= 0xF0; /* configure data pins as input */
+    if (LCD_DATA_NIBBLE) {
+        /* configure data pins as input */
+        DDR(LCD_DATA0_PORT) &= ~LCD_DATA_MASK;
 
         lcd_e_high();
         lcd_e_delay();
-        data = PIN(LCD_DATA0_PORT) << 4; /* read high nibble first */
+        /* read high nibble first */
+        data = (uint8_t)(((PIN(LCD_DATA0_PORT) & LCD_DATA_MASK) >>
+                          LCD_DATA0_PIN)
+                         << 4);
         lcd_e_low();
 
         lcd_e_delay(); /* Enable 500ns low       */
 
         lcd_e_high();
         lcd_e_delay();
-        data |= PIN(LCD_DATA0_PORT) & 0x0F; /* read low nibble        */
+        /* read low nibble */
+        data |= (PIN(LCD_DATA0_PORT) & LCD_DATA_MASK) >> LCD_DATA0_PIN;
         lcd_e_low();
     }
     else {
@@ -279,7 +399,12 @@ static uint8_t lcd_read(uint8_t rs)
 
 /*************************************************************************
 loops while lcd is busy, returns address counter
+the queued driver never waits here, the interrupt keeps the timing and
+the address counter is tracked in software
 *************************************************************************/
+#if LCD_ASYNC
+static uint8_t lcd_waitbusy(void) { return lcd_addr; }
+#else
 static uint8_t lcd_waitbusy(void)
 
 {
@@ -296,6 +421,7 @@ static uint8_t lcd_waitbusy(void)
     return (lcd_read(0)); // return address counter
 
 } /* lcd_waitbusy */
+#endif
 
 /*************************************************************************
 Move cursor to the start of next line or to the first line if the cursor
@@ -402,7 +528,19 @@ int lcd_getxy(void) { return lcd_waitbusy(); }
 /*************************************************************************
 Clear display and set cursor to home position
 *************************************************************************/
-void lcd_clrscr(void) { lcd_command(1 << LCD_CLR); }
+void lcd_clrscr(void)
+{
+    uint8_t x, y;
+
+    lcd_command(1 << LCD_CLR);
+
+    /* display shows spaces now */
+    for (y = 0; y < LCD_LINES; y++) {
+        for (x = 0; x < LCD_DISP_LENGTH; x++) {
+            lcd_shadow[y][x] = ' ';
+        }
+    }
+}
 
 /*************************************************************************
 Set cursor to home position
@@ -488,6 +626,163 @@ void lcd_puts_p(const char *progmem_s)
 
 } /* lcd_puts_p */
 
+/*************************************************************************
+Load custom glyphs into the character generator RAM
+Input:    first           first character code, 0 .. 7
+          count           number of glyphs
+          progmem_glyphs  8 row bytes per glyph in program memory
+Returns:  none
+*************************************************************************/
+void lcd_load_glyphs_p(uint8_t first, uint8_t count,
+                       const uint8_t *progmem_glyphs)
+{
+    uint8_t i;
+
+    if (first > 7) {
+        return;
+    }
+    if (first + count > 8) {
+        count = 8 - first;
+    }
+
+    /* CGRAM address counter increments by itself, 8 rows per glyph */
+    lcd_command((1 << LCD_CGRAM) | (first << 3));
+    for (i = 0; i < (count << 3); i++) {
+        lcd_data(pgm_read_byte(progmem_glyphs++));
+    }
+
+    /* back to DDRAM, the framebuffer sets the cursor before each run */
+    lcd_command(1 << LCD_DDRAM);
+
+} /* lcd_load_glyphs_p */
+
+/*************************************************************************
+Check whether queued writes are still being clocked out
+Returns:  0 when the display has executed everything written so far
+*************************************************************************/
+uint8_t lcd_busy(void)
+{
+#if LCD_ASYNC
+    return (TCCR0B & LCD_Q_TIMER_PS) ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+/*************************************************************************
+Clear the framebuffer to spaces and set its cursor to home position
+*************************************************************************/
+void lcd_fb_clear(void)
+{
+    uint8_t x, y;
+
+    for (y = 0; y < LCD_LINES; y++) {
+        for (x = 0; x < LCD_DISP_LENGTH; x++) {
+            lcd_frame[y][x] = ' ';
+        }
+    }
+    lcd_frame_x = 0;
+    lcd_frame_y = 0;
+
+} /* lcd_fb_clear */
+
+/*************************************************************************
+Set framebuffer cursor to specified position
+Input:    x  horizontal position  (0: left most position)
+          y  vertical position    (0: first line)
+Returns:  none
+*************************************************************************/
+void lcd_fb_gotoxy(uint8_t x, uint8_t y)
+{
+    lcd_frame_x = x;
+    lcd_frame_y = y;
+
+} /* lcd_fb_gotoxy */
+
+/*************************************************************************
+Draw character at framebuffer cursor
+Input:    character to be drawn, '\n' moves to start of next line
+Returns:  none
+*************************************************************************/
+void lcd_fb_putc(char c)
+{
+    if (c == '\n') {
+        lcd_frame_x = 0;
+        lcd_frame_y++;
+    }
+    else {
+        /* clip, nothing wraps */
+        if ((lcd_frame_x < LCD_DISP_LENGTH) && (lcd_frame_y < LCD_LINES)) {
+            lcd_frame[lcd_frame_y][lcd_frame_x] = c;
+        }
+        lcd_frame_x++;
+    }
+
+} /* lcd_fb_putc */
+
+/*************************************************************************
+Draw string at framebuffer cursor
+Input:    string to be drawn
+Returns:  none
+*************************************************************************/
+void lcd_fb_puts(const char *s)
+{
+    register char c;
+
+    while ((c = *s++)) {
+        lcd_fb_putc(c);
+    }
+
+} /* lcd_fb_puts */
+
+/*************************************************************************
+Draw string from program memory at framebuffer cursor
+Input:    string from program memory to be drawn
+Returns:  none
+*************************************************************************/
+void lcd_fb_puts_p(const char *progmem_s)
+{
+    register char c;
+
+    while ((c = pgm_read_byte(progmem_s++))) {
+        lcd_fb_putc(c);
+    }
+
+} /* lcd_fb_puts_p */
+
+/*************************************************************************
+Write the cells that changed since the last flush to the display.
+A run of changed cells costs one cursor command plus one write per cell,
+the address counter increments by itself inside the run.
+Returns:  number of bytes sent to the LCD controller
+*************************************************************************/
+uint8_t lcd_flush(void)
+{
+    uint8_t x, y;
+    uint8_t in_run;
+    uint8_t sent = 0;
+
+    for (y = 0; y < LCD_LINES; y++) {
+        in_run = 0;
+        for (x = 0; x < LCD_DISP_LENGTH; x++) {
+            if (lcd_frame[y][x] == lcd_shadow[y][x]) {
+                in_run = 0;
+                continue;
+            }
+            if (!in_run) {
+                lcd_gotoxy(x, y);
+                sent++;
+                in_run = 1;
+            }
+            lcd_data(lcd_frame[y][x]);
+            lcd_shadow[y][x] = lcd_frame[y][x];
+            sent++;
+        }
+    }
+    return sent;
+
+} /* lcd_flush */
+
 /*************************************************************************
 Initialize display and select type of cursor
 Input:    dispAttr LCD_DISP_OFF            display off
@@ -514,14 +809,10 @@ void lcd_init(uint8_t dispAttr)
         /* configure all port bits as output (all LCD lines on same port) */
         DDR(LCD_DATA0_PORT) |= 0x7F;
     }
-    else if ((&LCD_DATA0_PORT == &LCD_DATA1_PORT) &&
-             (&LCD_DATA1_PORT == &LCD_DATA2_PORT) &&
-             (&LCD_DATA2_PORT == &LCD_DATA3_PORT) && (LCD_DATA0_PIN == 0) &&
-             (LCD_DATA1_PIN == 1) && (LCD_DATA2_PIN == 2) &&
-             (LCD_DATA3_PIN == 3)) {
+    else if (LCD_DATA_NIBBLE) {
         /* configure all port bits as output (all LCD data lines on same port,
          * but control lines on different ports) */
-        DDR(LCD_DATA0_PORT) |= 0x0F;
+        DDR(LCD_DATA0_PORT) |= LCD_DATA_MASK;
         DDR(LCD_RS_PORT) |= _BV(LCD_RS_PIN);
         DDR(LCD_RW_PORT) |= _BV(LCD_RW_PIN);
         DDR(LCD_E_PORT) |= _BV(LCD_E_PIN);
@@ -537,6 +828,32 @@ void lcd_init(uint8_t dispAttr)
         DDR(LCD_DATA2_PORT) |= _BV(LCD_DATA2_PIN);
         DDR(LCD_DATA3_PORT) |= _BV(LCD_DATA3_PIN);
     }
+#if LCD_ASYNC
+    /* R/W is only ever low, data lines only ever output */
+    lcd_rw_low();
+    lcd_data_out_dir();
+
+    /* timer 0 CTC, one compare interrupt per nibble, started by lcd_write() */
+    PRR &= ~_BV(PRTIM0);
+    TCCR0A = _BV(WGM01);
+    TCCR0B = 0;
+    OCR0A = LCD_Q_TIMER_TOP;
+    TIMSK0 |= _BV(OCIE0A);
+    sei();
+
+    /* the 8 bit reset sequence runs from the queue as well, lcd_init()
+     * returns at once and the display comes up in the background */
+    lcd_q_delay(LCD_DELAY_BOOTUP);
+    lcd_q_put(LCD_FUNCTION_8BIT_1LINE >> 4);
+    lcd_q_delay(LCD_DELAY_INIT);
+    lcd_q_put(LCD_FUNCTION_8BIT_1LINE >> 4);
+    lcd_q_delay(LCD_DELAY_INIT_REP);
+    lcd_q_put(LCD_FUNCTION_8BIT_1LINE >> 4);
+    lcd_q_delay(LCD_DELAY_INIT_REP);
+    lcd_q_put(LCD_FUNCTION_4BIT_1LINE >> 4);
+    lcd_q_delay(LCD_DELAY_INIT_4BIT);
+    lcd_q_start();
+#else
     delay(LCD_DELAY_BOOTUP); /* wait 16ms or more after power-on       */
 
     /* initial write to lcd is 8bit */
@@ -557,6 +874,7 @@ void lcd_init(uint8_t dispAttr)
     LCD_DATA0_PORT &= ~_BV(LCD_DATA0_PIN); // LCD_FUNCTION_4BIT_1LINE>>4
     lcd_e_toggle();
     delay(LCD_DELAY_INIT_4BIT); /* some displays need this additional delay */
+#endif
 
     /* from now the LCD only accepts 4 bit I/O, we can use lcd_command() */
 #else
@@ -591,4 +909,47 @@ void lcd_init(uint8_t dispAttr)
     lcd_command(LCD_MODE_DEFAULT); /* set entry mode               */
     lcd_command(dispAttr);         /* display/cursor control       */
 
+    lcd_fb_clear(); /* framebuffer matches the cleared display */
+
 } /* lcd_init */
+
+#if LCD_ASYNC
+/*************************************************************************
+Timer 0 compare interrupt, clocks one queued nibble out per tick and
+stops the timer once the queue is empty
+*************************************************************************/
+ISR(TIMER0_COMPA_vect)
+{
+    uint8_t op;
+
+    if (lcd_q_wait) {
+        lcd_q_wait--;
+        return;
+    }
+    if (lcd_q_head == lcd_q_tail) {
+        TCCR0B = 0;
+        return;
+    }
+
+    op = lcd_q_buf[lcd_q_tail];
+    lcd_q_tail = (lcd_q_tail + 1) & LCD_Q_MASK;
+
+    if (op & LCD_Q_DELAY) {
+        lcd_q_wait = (op & ~LCD_Q_DELAY) * LCD_Q_MS_TICKS;
+        return;
+    }
+
+    if (op & LCD_Q_RS) {
+        lcd_rs_high();
+    }
+    else {
+        lcd_rs_low();
+    }
+    lcd_nibble_out(op);
+    lcd_e_toggle();
+
+    if (op & LCD_Q_WAIT_CLEAR) {
+        lcd_q_wait = LCD_Q_CLEAR_TICKS;
+    }
+}
+#endif
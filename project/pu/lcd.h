@@ -47,7 +47,7 @@
 
 */
 
-#include <avr/pgmspace.h>
+#include "hal.h"
 #include <inttypes.h>
 
 #if (__GNUC__ * 100 + __GNUC_MINOR__) < 405
@@ -240,6 +240,42 @@
     1 /**< enable signal pulse width in micro seconds */
 #endif
 
+/**
+ * @name Definitions for the asynchronous write queue
+ * With LCD_ASYNC set to 1 lcd_command(), lcd_data() and lcd_putc() only put
+ * nibbles into a RAM queue and return. The timer 0 compare interrupt clocks
+ * one nibble out every LCD_QUEUE_TICK_US, so each instruction has finished
+ * before the next nibble, and waits LCD_DELAY_CLEAR after clear / home.
+ * The busy flag is never read, R/W stays low and can be tied to ground.
+ * Requires 4-bit IO port mode.
+ * lcd_init() queues the power-on reset sequence too and returns at once,
+ * anything written after it is shown when the display is up.
+ * Writing to a full queue waits until the interrupt has made room.
+ * Timer 0 belongs to the queue. lcd_init() and every queue start clear
+ * PRTIM0 in PRR, so power code that shuts timer 0 down may run before or
+ * after lcd_init().
+ */
+#ifndef LCD_ASYNC
+#define LCD_ASYNC 1 /**< 0: poll busy flag, 1: queued, timer 0 driven */
+#endif
+/* Start-up queues about 122 ops (reset ~20, bar glyphs 84, welcome 18),
+ * 256 holds that and a full screen frame (68) without lcd_q_put() waiting */
+#ifndef LCD_QUEUE_SIZE
+#define LCD_QUEUE_SIZE 256 /**< queued nibbles, power of two up to 256 */
+#endif
+#ifndef LCD_QUEUE_TICK_US
+#define LCD_QUEUE_TICK_US                                                      \
+    40 /**< micro seconds per nibble, >= 37 us HD44780 execution time */
+#endif
+#ifndef LCD_DELAY_CLEAR
+#define LCD_DELAY_CLEAR                                                        \
+    2000 /**< micro seconds for clear display / return home (1.52 ms) */
+#endif
+
+#if LCD_ASYNC && !LCD_IO_MODE
+#error "LCD_ASYNC requires 4-bit IO port mode (LCD_IO_MODE 1)"
+#endif
+
 /**
  * @name Definitions for LCD command instructions
  * The constants define the various LCD controller instructions which can be
@@ -373,11 +409,86 @@ extern void lcd_command(uint8_t cmd);
 */
 extern void lcd_data(uint8_t data);
 
+/**
+ @brief    Check whether queued writes are still being clocked out
+ @return   0 when the display has executed everything written so far
+*/
+extern uint8_t lcd_busy(void);
+
 /**
  @brief macros for automatically storing string constant in program memory
 */
 #define lcd_puts_P(__s) lcd_puts_p(PSTR(__s))
 
+/**
+ @brief    Load custom glyphs into the character generator RAM
+           Glyph n is then shown for character code n (and n + 8). Codes
+           already on the display change with it. Load once at init, the
+           cursor position is lost.
+ @param    first       first character code to load, 0 .. 7
+ @param    count       number of glyphs, first + count <= 8
+ @param    progmem_glyphs 8 bytes per glyph in program memory, one per row
+                       from the top, the 5 low bits are the pixels
+ @return   none
+*/
+extern void lcd_load_glyphs_p(uint8_t first, uint8_t count,
+                              const uint8_t *progmem_glyphs);
+
+/**
+ *  @name Framebuffer functions
+ *  Text is drawn into a RAM copy of the display. lcd_flush() compares it with
+ *  a shadow of what the display currently shows and writes only the cells
+ *  that differ, consecutive cells in one run without cursor moves.
+ *  Do not mix with the direct write functions above, except lcd_clrscr().
+ */
+
+/**
+ @brief    Clear the framebuffer to spaces and set its cursor to home position
+ @return   none
+*/
+extern void lcd_fb_clear(void);
+
+/**
+ @brief    Set framebuffer cursor to specified position
+ @param    x horizontal position\n (0: left most position)
+ @param    y vertical position\n   (0: first line)
+ @return   none
+*/
+extern void lcd_fb_gotoxy(uint8_t x, uint8_t y);
+
+/**
+ @brief    Draw character at framebuffer cursor, '\n' moves to the next line.
+           Characters past the end of a line are dropped.
+ @param    c character to be drawn
+ @return   none
+*/
+extern void lcd_fb_putc(char c);
+
+/**
+ @brief    Draw string at framebuffer cursor
+ @param    s string to be drawn
+ @return   none
+*/
+extern void lcd_fb_puts(const char *s);
+
+/**
+ @brief    Draw string from program memory at framebuffer cursor
+ @param    progmem_s string from program memory to be drawn
+ @return   none
+*/
+extern void lcd_fb_puts_p(const char *progmem_s);
+
+/**
+ @brief    Write the cells that changed since the last flush to the display
+ @return   number of bytes sent to the LCD controller, commands included
+*/
+extern uint8_t lcd_flush(void);
+
+/**
+ @brief macros for automatically storing string constant in program memory
+*/
+#define lcd_fb_puts_P(__s) lcd_fb_puts_p(PSTR(__s))
+
 /**@}*/
 
 #endif // LCD_H
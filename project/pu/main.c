@@ -1,14 +1,17 @@
-#include "timer1.h"
-
-#include <avr/interrupt.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <util/delay.h>
 
+#include "bar.h"
+#include "buzzer.h"
+#include "countdown.h"
+#include "hal.h"
 #include "lcd.h"
-#include "notes.h"
-#include "timer1.h"
-#include "uart.h"
+#include "log.h"
+#include "power.h"
+#include "protocol.h"
+#include "screen.h"
+#include "stack.h"
+#include "trace.h"
 
 #define F_CPU 16000000UL
 #define SLAVE_ADDRESS 170
@@ -16,261 +19,380 @@
 #define MYUBRR (((F_CPU / 16) / BAUD) - 1)
 
 // Max size of transferable data
-#define DATA_SIZE 16
+#define DATA_SIZE FRAME_SIZE
+
+// Masked keys at the end of line 1, after the countdown bar
+#define KEYS_X 12
+#define KEYS_Y 1
+#define KEYS_WIDTH 4
+
+// Key echo latency probe, high from the echo frame until the LCD
+// controller has the cell. Compare with the KEY_ECHO_PROBE pin of the Mega.
+#ifdef KEY_ECHO_PROBE
+#define KEY_ECHO_PROBE_PIN HAL_PIN(C, 0)
+#endif
+
+// Start-up probe, PC1 goes high once the TWI address is acknowledged and
+// PC2 once the welcome screen reached the LCD controller. Measure both from
+// the reset line.
+#ifdef STARTUP_PROBE
+#define STARTUP_PROBE_TWI HAL_PIN(C, 1)
+#define STARTUP_PROBE_LCD HAL_PIN(C, 2)
+#endif
 
 // LCD Display PINS NOTE remember to change from lcd.h also
-const int LCD_RS = PB2;
-const int LCD_RW = PB3;
-const int LCD_EN = PB4;
+const hal_pin_t LCD_RS = HAL_PIN(B, 2);
+const hal_pin_t LCD_RW = HAL_PIN(B, 3);
+const hal_pin_t LCD_EN = HAL_PIN(B, 4);
 
-const int LCD_D4 = PD4;
-const int LCD_D5 = PD5;
-const int LCD_D6 = PD6;
-const int LCD_D7 = PD7;
+const hal_pin_t LCD_D4 = HAL_PIN(D, 4);
+const hal_pin_t LCD_D5 = HAL_PIN(D, 5);
+const hal_pin_t LCD_D6 = HAL_PIN(D, 6);
+const hal_pin_t LCD_D7 = HAL_PIN(D, 7);
 
 // Buzzer pin
-const int BUZZER = PB1;
-const int BUILTIN = PB5;
+const hal_pin_t BUZZER = HAL_PIN(B, 1);
+const hal_pin_t BUILTIN = HAL_PIN(B, 5);
+
+// Frame handler, gets the whole frame with the screen ID in data[0]
+typedef void (*frame_handler_t)(uint8_t *data, uint8_t len);
+
+// Dispatch table entry, frame lengths include the screen ID
+typedef struct {
+    frame_handler_t handler;
+    uint8_t min_len;
+    uint8_t max_len;
+} frame_type_t;
 
 // Parser to check system condition
-static void parser(char *data);
+static HAL_MEASURED void parser(uint8_t *data, uint8_t len);
 
-// I2C / TWI communication initialization with Master.
-static void i2c_init_slave_receiver(uint8_t address);
+// Print frame counters over UART
+static void parser_report();
 
-// I2C / TWI receive from Master.
-static void i2c_receive(char *dest);
+// Frame handlers
+static void on_screen(uint8_t *data, uint8_t len);
+static void on_countdown(uint8_t *data, uint8_t len);
+static void on_correct(uint8_t *data, uint8_t len);
+static void on_wrong(uint8_t *data, uint8_t len);
+static void on_time_up(uint8_t *data, uint8_t len);
+static void on_armed(uint8_t *data, uint8_t len);
+static void on_keys(uint8_t *data, uint8_t len);
 
-// Rearm system
-static void rearm(char *recv);
+// Draw masked keys over the current screen
+static void keys_draw();
 
-// Interrupt routine for timer
-ISR(TIMER1_COMPA_vect) { TCNT1 = 0; }
+// Rearm system
+static void rearm();
+
+// Handlers by screen ID. IDs are dense, so dispatch is one indexed flash
+// read whatever the number of types. Entries left out have no handler.
+static const frame_type_t g_frame_types[SCREEN_COUNT] PROGMEM = {
+    [SCREEN_WELCOME] = {on_screen, 1, 1},
+    [SCREEN_MOVEMENT] = {on_countdown, 1, 1},
+    [SCREEN_COUNTDOWN] = {on_countdown, 5, 5},
+    [SCREEN_CORRECT] = {on_correct, 1, DATA_SIZE},
+    [SCREEN_WRONG] = {on_wrong, 1, DATA_SIZE},
+    [SCREEN_TIME_UP] = {on_time_up, 1, 1},
+    [SCREEN_ARMED] = {on_armed, 1, 1},
+    [SCREEN_ERROR] = {on_screen, 3, 3},
+    [SCREEN_USER] = {on_screen, 3, 3},
+    [SCREEN_KEYS] = {on_keys, 3, 3},
+};
+
+// Frames handled per screen ID, unknown IDs and bad lengths
+static uint16_t g_frame_count[SCREEN_COUNT];
+static uint16_t g_frame_unknown;
+static uint16_t g_frame_bad_length;
+
+// Keys entered so far, shown as '*' until the code is sent
+static uint8_t g_keys;
 
 // Main function that includes the main loop
 int main(void)
 {
+    // Setup TWI communication with Master first, the address is acknowledged
+    // from here on while the rest of the board comes up. A frame arriving
+    // before the loop runs is held by clock stretching. The start-up fits
+    // the LCD queue, so the loop runs within microseconds and early frames
+    // are read as they come, their drawing queues behind the LCD init.
+    hal_twi_slave_init(SLAVE_ADDRESS);
+
+#ifdef STARTUP_PROBE
+    hal_gpio_output(STARTUP_PROBE_TWI);
+    hal_gpio_output(STARTUP_PROBE_LCD);
+    hal_gpio_write(STARTUP_PROBE_TWI, 1);
+#endif
+
     /*      LCD PINS     */
     // OUTPUTS CONTROL
-    DDRB |= (1 << LCD_RS) | (1 << LCD_RW) | (1 << LCD_EN) | (1 << BUILTIN);
+    hal_gpio_output(LCD_RS);
+    hal_gpio_output(LCD_RW);
+    hal_gpio_output(LCD_EN);
+    hal_gpio_output(BUILTIN);
     // OUTPUTS DATA
-    DDRD |= (1 << LCD_D4) | (1 << LCD_D5) | (1 << LCD_D6) | (1 << LCD_D7);
+    hal_gpio_output(LCD_D4);
+    hal_gpio_output(LCD_D5);
+    hal_gpio_output(LCD_D6);
+    hal_gpio_output(LCD_D7);
 
     // Buzzer OUTPUT
-    DDRB |= (1 << BUZZER);
+    hal_gpio_output(BUZZER);
+
+#ifdef KEY_ECHO_PROBE
+    hal_gpio_output(KEY_ECHO_PROBE_PIN);
+#endif
 
     // Initialize empty recv char array
-    char recv[DATA_SIZE] = {'\0'};
+    uint8_t recv[DATA_SIZE] = {0};
+    uint8_t recv_len;
 
     // Init debug communication Through USB
-    usart_init(MYUBRR);
-    stdin = &mystdin;
-    stdout = &mystdout;
+    hal_uart_init(MYUBRR);
+
+    // Built in led is blinked by the watchdog to indicate that board is
+    // waiting for transmission. power_init() shuts timer 0 down, the LCD
+    // queue powers it up again whenever it starts.
+    power_init();
+
+    // Trace dumps on request over UART
+    trace_init();
 
-    // Init LCD display
+    // Init LCD display, the power-on delays run from the queue so this
+    // returns in microseconds and the welcome screen follows in ~30 ms
     lcd_init(LCD_DISP_ON);
-    lcd_clrscr();
-    lcd_puts("Welcome!");
+    bar_init();
+    screen_draw(SCREEN_WELCOME, 0, 0);
+    lcd_flush();
 
-    // Setup TWI communication with Master
-    i2c_init_slave_receiver(SLAVE_ADDRESS);
+#ifdef STARTUP_PROBE
+    while (lcd_busy()) {
+        ;
+    }
+    hal_gpio_write(STARTUP_PROBE_LCD, 1);
+#endif
 
     for (;;) {
-        // wait for transmission:
-        while (!(TWCR & (1 << TWINT))) {
-            // Built in led is blinked to indicate that board is waiting for
-            // transmission.
-            PORTB |= (1 << BUILTIN);
-            _delay_ms(200);
-            PORTB &= ~(1 << BUILTIN);
-            _delay_ms(200);
+        // Sleep until TWI address match, the next countdown step or a trace
+        // request, wake up by other interrupts only checks the conditions
+        // again.
+        hal_irq_disable();
+        while (!hal_twi_pending() && !countdown_pending() &&
+               !trace_pending()) {
+            power_sleep();
+            hal_irq_disable();
         }
-        // When transmission is coming, the information will be stored in the
-        // recv array.
-        i2c_receive(recv);
+        hal_irq_enable();
+
+        trace_poll();
+
+        if (hal_twi_pending()) {
+            // When transmission is coming, the information will be stored in
+            // the recv array.
+            recv_len = hal_twi_read(recv, DATA_SIZE);
+
+            // The received data is parsed and information is printed to the
+            // LCD.
+            parser(recv, recv_len);
 
-        // The received data is parsed and information is printed to the LCD.
-        parser(recv);
+            // Wake up again on next address match
+            hal_twi_listen();
+
+            power_report();
+            parser_report();
+            stack_report();
+        }
+
+        // Countdown runs on between the Mega's resync frames
+        if (countdown_pending() && countdown_update()) {
+            keys_draw();
+            lcd_flush();
+        }
     }
 
     return 0;
 }
 
 /*
- * Check the system status based on received data
+ * Check the system status based on received data. The first byte is the
+ * screen ID and selects the handler from g_frame_types, the typed
+ * parameters after it fill the screen template.
  *
- * @param char *data received from Master
- * @param char *code potential storage for users code
+ * @param uint8_t *data frame received from Master
+ * @param uint8_t len length of the frame
  *
  * @returns void
  */
-static void parser(char *data)
+static void parser(uint8_t *data, uint8_t len)
 {
-    // First byte of data is checked as it represents the system state.
-    uint8_t idx = 0;
-    ;
-
-    // LCD prints and buzzer is turned on
-    // based on character received
-    if (data[idx] == 'M') {
-        lcd_clrscr();
-        lcd_puts("Status:");
-        lcd_gotoxy(0, 1);
-        lcd_puts("Movement!");
-    }
+    frame_handler_t handler = 0;
 
-    else if (data[idx] == 'C') {
-        lcd_clrscr();
-        lcd_puts("Correct Password");
-        lcd_gotoxy(0, 1);
-        // First byte is state, print rest to LCD
-        lcd_puts(&data[1]);
-        // Correct password, so buzzer is offed via timer clear.
-        timer1_clear();
+    // Empty frame, nothing to show
+    if (0 == len) {
+        return;
     }
 
-    else if (data[idx] == 'W') {
-        lcd_clrscr();
-        lcd_puts("Wrong Password:");
-        lcd_gotoxy(0, 1);
-        // First byte is state, print rest to LCD
-        lcd_puts(&data[1]);
-
-        // Initialize timer 1 PWM mode
-        timer1_init_mode_9();
-        // Setup for playing a Note
-        timer1_set_prescaler(PS_8);
-        timer1_set_target(NOTE_C3);
+    if (SCREEN_COUNT > data[0]) {
+        handler =
+            (frame_handler_t)pgm_read_ptr(&g_frame_types[data[0]].handler);
     }
-
-    else if (data[idx] == 'T') {
-        lcd_clrscr();
-        lcd_puts("Status:");
-        lcd_gotoxy(0, 1);
-        lcd_puts("TIME IS UP!");
-
-        // Initialize timer 1 PWM mode
-        timer1_init_mode_9();
-        // Setup for playing a Note
-        timer1_set_prescaler(PS_8);
-        timer1_set_target(NOTE_C3);
+    if (!handler) {
+        TRACE(TRACE_TWI_BAD, data[0], len);
+        g_frame_unknown++;
+        return;
     }
-
-    else if (data[idx] == 'R') {
-        // Reset LCD and buzzer
-        rearm(data);
+    if ((pgm_read_byte(&g_frame_types[data[0]].min_len) > len) ||
+        (pgm_read_byte(&g_frame_types[data[0]].max_len) < len)) {
+        TRACE(TRACE_TWI_BAD, data[0], len);
+        g_frame_bad_length++;
+        return;
     }
+    g_frame_count[data[0]]++;
+    TRACE(TRACE_TWI_RX, data[0], len);
+
+    handler(data, len);
+
+    // Only the characters that changed are written to the LCD, no clear
+    // and no flicker.
+    lcd_flush();
 }
 
 /*
- * Resets recv, lcd and buzzer
+ * Print frame counters over UART, handled frames per screen ID then
+ * unknown IDs and frames of the wrong length.
  */
-static void rearm(char *recv)
+static void parser_report()
 {
-    // Reset recv
-    for (uint8_t idx = 0; (DATA_SIZE) > idx; idx++) {
-        recv[idx] = '\0';
+    LOG("frames:");
+    for (uint8_t id = 1; SCREEN_COUNT > id; id++) {
+        LOG(" %u", g_frame_count[id]);
     }
-
-    // Reset lcd
-    lcd_clrscr();
-    lcd_puts("Status:");
-    lcd_gotoxy(0, 1);
-    lcd_puts("Armed");
-
-    // clear buzzer
-    timer1_clear();
+    LOG(", unknown %u, bad length %u\n", g_frame_unknown, g_frame_bad_length);
 }
 
 /*
- * Function to setup device as slave receiver.
- *
- * Follows closely Atmel Mega 2560 document of which page 253 - 254 contain
- * relevant information. Figure 24-15.
+ * Screens without side effects, only drawn.
  */
-static void i2c_init_slave_receiver(uint8_t address)
+static void on_screen(uint8_t *data, uint8_t len)
 {
-    // Devices own Slave Address
-    TWAR = address;
-
-    // Slave receiver mode setup.
-    TWCR |= (1 << TWEA) | (1 << TWEN);
-
-    // Explicitly set to 0i2c_receive
-    TWCR &= ~(1 << TWSTA) & ~(1 << TWSTO);
-    // Eqv: TWCR = 0b01000100;
+    countdown_hide();
+    screen_draw(data[0], &data[1], len - 1);
 }
 
 /*
- Function to receive data from Master:
+ * Movement and countdown start or resync, the UNO counts down on its own
+ * in between. Keys entered stay visible over the redrawn screen.
  */
-static void i2c_receive(char *received)
+static void on_countdown(uint8_t *data, uint8_t len)
 {
-    uint8_t twi_stat = 0;
-    uint8_t twi_idx = 0;
+    const uint8_t *remaining = screen_param(&data[1], len - 1, 0);
+    const uint8_t *total = screen_param(&data[1], len - 1, 1);
 
-    // Waiting for TWINT to set:
-    while (!(TWCR & (1 << TWINT))) {
-        ;
+    if (remaining && total && (PARAM_SECONDS == remaining[0]) &&
+        (PARAM_SECONDS == total[0])) {
+        countdown_start(remaining[1], total[1]);
     }
-
-    // Make sure the received array is full of nulls
-    for (uint8_t idx = 0; DATA_SIZE > idx; idx++) {
-        received[idx] = '\0';
+    else {
+        // Movement, no time known
+        g_keys = 0;
+        countdown_start(0, 0);
     }
+    countdown_update();
+    keys_draw();
+}
 
-    // Waiting for TWINT to set:
-    while (!(TWCR & (1 << TWINT))) {
-        ;
-    }
-
-    // Set status
-    twi_stat = (TWSR & 0xF8);
-
-    // Reset the TWEA and TWEN and create ACK
-    TWCR |= (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
-
-    // Waiting for TWINT to set:
-    while (!(TWCR & (1 << TWINT))) {
-        ;
-    }
+/*
+ * Correct code, buzzer is offed.
+ */
+static void on_correct(uint8_t *data, uint8_t len)
+{
+    g_keys = 0;
+    countdown_stop();
+    screen_draw(data[0], &data[1], len - 1);
+    buzzer_stop();
+}
 
-    // Set status
-    twi_stat = (TWSR & 0xF8);
+/*
+ * Wrong code beeps until correct code is given.
+ */
+static void on_wrong(uint8_t *data, uint8_t len)
+{
+    // Shown until the next resync, the countdown goes on meanwhile
+    g_keys = 0;
+    countdown_hide();
+    screen_draw(data[0], &data[1], len - 1);
+    buzzer_play(BUZZER_WRONG_CODE);
+}
 
-    // HEX values can be found in atmega 2560 doc page: 255, table: 24-4
-    // Condition check of twi_status if previous was response of either slave
-    // address or general call and ACK return
-    while ((0x80 == twi_stat) || (0x90 == twi_stat)) {
-        received[twi_idx] = TWDR;
-        twi_idx++;
+/*
+ * Alarm sounds until correct code is given.
+ */
+static void on_time_up(uint8_t *data, uint8_t len)
+{
+    countdown_stop();
+    screen_draw(data[0], &data[1], len - 1);
+    buzzer_play(BUZZER_ALARM);
+}
 
-        if (('\0' == received[twi_idx - 1]) || (DATA_SIZE <= twi_idx)) {
-            break;
-        }
+/*
+ * Reset LCD and buzzer.
+ */
+static void on_armed(uint8_t *data, uint8_t len)
+{
+    g_keys = 0;
+    countdown_stop();
+    rearm();
+}
 
-        // Reset the TWEA and TWEN, create ACK
-        TWCR |= (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
+/*
+ * Key echo, a digit, delete or clear on the keypad. Drawn over the current
+ * screen, one more or one less '*' is a single cell for lcd_flush().
+ */
+static void on_keys(uint8_t *data, uint8_t len)
+{
+    const uint8_t *keys = screen_param(&data[1], len - 1, 0);
 
-        // Wait for TWINT to set
-        while (!(TWCR & (1 << TWINT))) {
-            ;
-        }
+#ifdef KEY_ECHO_PROBE
+    hal_gpio_write(KEY_ECHO_PROBE_PIN, 1);
+#endif
 
-        // Status update
-        twi_stat = (TWSR & 0xF8);
+    if (keys && (PARAM_KEYS == keys[0])) {
+        g_keys = keys[1];
     }
+    keys_draw();
 
-    // check for NOT ACK or general Call
-    if ((0x88 == twi_stat) || (0x98 == twi_stat)) {
-        received[twi_idx] = TWDR;
-        twi_idx++;
+#ifdef KEY_ECHO_PROBE
+    // Visible once the queued write has been clocked out
+    lcd_flush();
+    while (lcd_busy()) {
+        ;
     }
+    hal_gpio_write(KEY_ECHO_PROBE_PIN, 0);
+#endif
+}
 
-    // STOP signal or repeated start signal
-    else if ((0xA0 == twi_stat)) {
-        TWCR |= (1 << TWINT);
+/*
+ * Draw g_keys as '*' at the end of line 1, the rest of the field blank.
+ */
+static void keys_draw()
+{
+    lcd_fb_gotoxy(KEYS_X, KEYS_Y);
+    for (uint8_t idx = 0; KEYS_WIDTH > idx; idx++) {
+        lcd_fb_putc((g_keys > idx) ? '*' : ' ');
     }
 }
 
+/*
+ * Resets lcd and buzzer. The frame is left alone, handlers only own its
+ * len bytes and hal_twi_read() zeroes the buffer before the next one.
+ */
+static void rearm()
+{
+    // Reset lcd
+    screen_draw(SCREEN_ARMED, 0, 0);
+
+    // Armed chime, stops by itself
+    buzzer_play(BUZZER_ARMED);
+}
+
 /* EOF */
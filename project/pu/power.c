@@ -0,0 +1,140 @@
+#include "power.h"
+
+#include "log.h"
+
+// Libs
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// State the CPU is in when the watchdog fires
+static volatile uint8_t g_power_state = POWER_AWAKE;
+
+// Watchdog ticks spent per state
+static volatile uint16_t g_power_ticks[POWER_STATES] = {0};
+
+// Free running watchdog tick count, time base while the CPU sleeps
+static volatile uint8_t g_power_tick_count = 0;
+
+/*
+ * Shut down peripherals unused by the display node and start the watchdog
+ * heartbeat.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_init()
+{
+    // ADC has to be disabled before it is shut down, comparator is not used.
+    ADCSRA &= ~(1 << ADEN);
+    ACSR |= (1 << ACD);
+
+    // TWI, USART0 and timer 1 stay powered: UNO 328p doc 45 chapter 9.11
+    PRR |= (1 << PRADC) | (1 << PRSPI) | (1 << PRTIM0) | (1 << PRTIM2);
+
+    // Watchdog in interrupt mode, 250 ms: UNO 328p doc 55 table 10-3.
+    // Timed sequence, WDE and WDCE first then the new configuration.
+    cli();
+    wdt_reset();
+    MCUSR &= ~(1 << WDRF);
+    WDTCSR = (1 << WDCE) | (1 << WDE);
+    WDTCSR = (1 << WDIE) | (1 << WDP2);
+    sei();
+}
+
+/*
+ * Sleep until any enabled interrupt fires. Must be called with interrupts
+ * disabled after the wake condition has been checked, interrupts are enabled
+ * on return. Idle is used while a timer runs (buzzer tone and tick, LCD
+ * queue), otherwise POWER_DEEP_SLEEP_MODE.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_sleep()
+{
+    // Clock select bits are non zero while the buzzer plays or the LCD queue
+    // drains, timers stop in standby
+    if ((TCCR0B & 0b00000111) || (TCCR1B & 0b00000111) ||
+        (TCCR2B & 0b00000111)) {
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        g_power_state = POWER_IDLE;
+        sleep_enable();
+        sei();
+        sleep_cpu();
+    }
+    else {
+        set_sleep_mode(POWER_DEEP_SLEEP_MODE);
+        g_power_state = POWER_DEEP;
+        sleep_enable();
+        sleep_bod_disable();
+        sei();
+        sleep_cpu();
+    }
+    sleep_disable();
+    g_power_state = POWER_AWAKE;
+}
+
+/*
+ * Watchdog ticks since power_init(), POWER_TICK_MS each. Wraps around,
+ * the difference of two readings is the time between them.
+ *
+ * @param None
+ * @returns uint8_t tick count
+ */
+uint8_t power_ticks() { return g_power_tick_count; }
+
+/*
+ * Start the watchdog period again, the next tick comes a full
+ * POWER_TICK_MS from now. WDR clears the watchdog counter, in interrupt
+ * mode that is all it does.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_tick_restart() { wdt_reset(); }
+
+/*
+ * Print time spent in each sleep state over UART.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_report()
+{
+    uint16_t ticks[POWER_STATES];
+
+    cli();
+    for (uint8_t idx = 0; POWER_STATES > idx; idx++) {
+        ticks[idx] = g_power_ticks[idx];
+    }
+    sei();
+
+    // Clear TXC0 so the end of the report can be detected below.
+    UCSR0A |= (1 << TXC0);
+
+    LOG("sleep: awake %lu ms, idle %lu ms, deep %lu ms\n",
+        (uint32_t)ticks[POWER_AWAKE] * POWER_TICK_MS,
+        (uint32_t)ticks[POWER_IDLE] * POWER_TICK_MS,
+        (uint32_t)ticks[POWER_DEEP] * POWER_TICK_MS);
+
+    // Deep sleep stops the USART clock, let the last frame leave first.
+    while (!(UCSR0A & (1 << TXC0))) {
+        ;
+    }
+}
+
+/*
+ * Interrupt Service Routine for the watchdog. Blinks the heartbeat led and
+ * samples which sleep state the CPU was in.
+ */
+ISR(WDT_vect)
+{
+    POWER_HEARTBEAT_PORT ^= (1 << POWER_HEARTBEAT_PIN);
+    g_power_ticks[g_power_state]++;
+    g_power_tick_count++;
+}
+
+/*
+ EOF
+ */
@@ -0,0 +1,75 @@
+#ifndef _POWER_H
+#define _POWER_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+/*
+ * Sleep state used while nothing else needs the I/O clock. Standby keeps the
+ * crystal running so a TWI address match resumes in 6 cycles and the Master
+ * sees almost no clock stretching. SLEEP_MODE_PWR_DOWN saves a bit more but
+ * needs 16K CK (1 ms) of oscillator start-up while SCL is held low.
+ */
+#ifndef POWER_DEEP_SLEEP_MODE
+#define POWER_DEEP_SLEEP_MODE SLEEP_MODE_STANDBY
+#endif
+
+// Heartbeat led toggled from the watchdog interrupt every 250 ms
+#define POWER_HEARTBEAT_PORT PORTB
+#define POWER_HEARTBEAT_PIN PB5
+#define POWER_TICK_MS 250
+
+// Sleep states the watchdog tick is accounted to
+#define POWER_AWAKE 0
+#define POWER_IDLE 1
+#define POWER_DEEP 2
+#define POWER_STATES 3
+
+/*
+ * Shut down peripherals unused by the display node and start the watchdog
+ * heartbeat.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_init();
+
+/*
+ * Sleep until any enabled interrupt fires. Must be called with interrupts
+ * disabled after the wake condition has been checked, interrupts are enabled
+ * on return. Idle is used while a timer runs (buzzer tone and tick, LCD
+ * queue), otherwise POWER_DEEP_SLEEP_MODE.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_sleep();
+
+/*
+ * Watchdog ticks since power_init(), POWER_TICK_MS each. Wraps around,
+ * the difference of two readings is the time between them.
+ *
+ * @param None
+ * @returns uint8_t tick count
+ */
+uint8_t power_ticks();
+
+/*
+ * Start the watchdog period again, the next tick comes a full
+ * POWER_TICK_MS from now.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_tick_restart();
+
+/*
+ * Print time spent in each sleep state over UART.
+ *
+ * @param None
+ * @returns Void
+ */
+void power_report();
+
+#endif // _POWER_H
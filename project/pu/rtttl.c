@@ -0,0 +1,273 @@
+#include "rtttl.h"
+
+#include "hal.h"
+#include "notes.h"
+#include "timer1.h"
+
+// RTTTL defaults when the header leaves them out
+#define RTTTL_DEFAULT_DURATION 4
+#define RTTTL_DEFAULT_OCTAVE 6
+#define RTTTL_DEFAULT_BPM 63
+
+// Slowest tempo, a whole note of 240000 / bpm ms has to fit 16 bits
+#define RTTTL_MIN_BPM 4
+
+// Shortest note, 1/64. Longer values would not fit the default duration.
+#define RTTTL_MAX_DURATION 64
+
+// Octave range accepted, TOP values are shifted from octave 4
+#define RTTTL_MIN_OCTAVE 1
+#define RTTTL_MAX_OCTAVE 8
+
+// TOP values of octave 4, other octaves are one shift per octave away
+static const uint16_t g_octave4_top[12] PROGMEM = {
+    TIMER1_NOTE_TOP(NOTE_C4),  TIMER1_NOTE_TOP(NOTE_CS4),
+    TIMER1_NOTE_TOP(NOTE_D4),  TIMER1_NOTE_TOP(NOTE_DS4),
+    TIMER1_NOTE_TOP(NOTE_E4),  TIMER1_NOTE_TOP(NOTE_F4),
+    TIMER1_NOTE_TOP(NOTE_FS4), TIMER1_NOTE_TOP(NOTE_G4),
+    TIMER1_NOTE_TOP(NOTE_GS4), TIMER1_NOTE_TOP(NOTE_A4),
+    TIMER1_NOTE_TOP(NOTE_AS4), TIMER1_NOTE_TOP(NOTE_B4),
+};
+
+// Semitone of letters a - h from C, h is the european name of b
+static const uint8_t g_semitone[8] = {9, 11, 0, 2, 4, 5, 7, 11};
+
+/*
+ * Current byte of the tune, 0 at the end. Erased EEPROM reads as 0xFF.
+ */
+static uint8_t rtttl_peek(rtttl_t *tune)
+{
+    uint8_t c = tune->read(tune->pos);
+
+    if (0xFF == c) {
+        return 0;
+    }
+    // Lower case letters
+    if (('A' <= c) && ('Z' >= c)) {
+        c += 'a' - 'A';
+    }
+    return c;
+}
+
+/*
+ * Skip spaces, returns the next byte.
+ */
+static uint8_t rtttl_skip_spaces(rtttl_t *tune)
+{
+    uint8_t c;
+
+    while (' ' == (c = rtttl_peek(tune))) {
+        tune->pos++;
+    }
+    return c;
+}
+
+/*
+ * Read a decimal number, 0 if there are no digits. Saturates instead of
+ * overflowing.
+ */
+static uint16_t rtttl_number(rtttl_t *tune)
+{
+    uint16_t value = 0;
+    uint8_t c;
+
+    while ((c = rtttl_peek(tune)) && ('0' <= c) && ('9' >= c)) {
+        if (6000 > value) {
+            value = (value * 10) + (c - '0');
+        }
+        tune->pos++;
+    }
+    return value;
+}
+
+/*
+ * Parse the name and the d, o, b defaults of a tune.
+ *
+ * @param rtttl_t *tune decoder state to initialize
+ * @param const char *src address of the tune
+ * @param rtttl_reader_t read function reading one byte of src
+ *
+ * @returns uint8_t 0 for success, 1 if there is no tune at src
+ */
+uint8_t rtttl_open(rtttl_t *tune, const char *src, rtttl_reader_t read)
+{
+    uint16_t bpm = RTTTL_DEFAULT_BPM;
+    uint16_t duration = RTTTL_DEFAULT_DURATION;
+    uint8_t key;
+    uint8_t c;
+
+    tune->read = read;
+    tune->pos = src;
+    tune->first = src;
+    tune->duration = RTTTL_DEFAULT_DURATION;
+    tune->octave = RTTTL_DEFAULT_OCTAVE;
+    tune->whole_ms = 0;
+
+    // Name is not needed
+    while ((c = rtttl_peek(tune)) && (':' != c)) {
+        tune->pos++;
+    }
+    if (!c) {
+        return 1;
+    }
+    tune->pos++;
+
+    // Defaults section: key=value pairs separated by commas
+    while ((key = rtttl_skip_spaces(tune)) && (':' != key)) {
+        tune->pos++;
+        if ('=' == rtttl_skip_spaces(tune)) {
+            tune->pos++;
+            rtttl_skip_spaces(tune);
+            switch (key) {
+            case 'd':
+                duration = rtttl_number(tune);
+                break;
+            case 'o':
+                tune->octave = rtttl_number(tune);
+                break;
+            case 'b':
+                bpm = rtttl_number(tune);
+                break;
+            default:
+                rtttl_number(tune);
+                break;
+            }
+        }
+        if (',' == rtttl_skip_spaces(tune)) {
+            tune->pos++;
+        }
+    }
+    if (!key) {
+        return 1;
+    }
+    tune->pos++;
+    tune->first = tune->pos;
+
+    // Sanitize, a whole note lasts four beats
+    if (0 == duration) {
+        duration = RTTTL_DEFAULT_DURATION;
+    }
+    if (RTTTL_MAX_DURATION < duration) {
+        duration = RTTTL_MAX_DURATION;
+    }
+    tune->duration = (uint8_t)duration;
+    if ((RTTTL_MIN_OCTAVE > tune->octave) ||
+        (RTTTL_MAX_OCTAVE < tune->octave)) {
+        tune->octave = RTTTL_DEFAULT_OCTAVE;
+    }
+    if (0 == bpm) {
+        bpm = RTTTL_DEFAULT_BPM;
+    }
+    if (RTTTL_MIN_BPM > bpm) {
+        bpm = RTTTL_MIN_BPM;
+    }
+    tune->whole_ms = 240000UL / bpm;
+
+    return 0;
+}
+
+/*
+ * Decode the next note.
+ *
+ * @param rtttl_t *tune decoder state
+ * @param uint16_t *top timer 1 TOP value, 0 for a pause
+ * @param uint16_t *ms duration in milliseconds
+ *
+ * @returns uint8_t 1 if a note was decoded, 0 at the end of the tune
+ */
+uint8_t rtttl_next(rtttl_t *tune, uint16_t *top, uint16_t *ms)
+{
+    uint16_t duration;
+    uint8_t octave;
+    uint8_t semitone = 0xFF;
+    uint8_t dotted = 0;
+    uint8_t c;
+
+    c = rtttl_skip_spaces(tune);
+    if (!c) {
+        return 0;
+    }
+
+    duration = rtttl_number(tune);
+    if (0 == duration) {
+        duration = tune->duration;
+    }
+    if (RTTTL_MAX_DURATION < duration) {
+        duration = RTTTL_MAX_DURATION;
+    }
+
+    // Note letter, p is a pause
+    c = rtttl_peek(tune);
+    if (('a' <= c) && ('h' >= c)) {
+        semitone = g_semitone[c - 'a'];
+    }
+    if (c) {
+        tune->pos++;
+    }
+    if ('#' == rtttl_peek(tune)) {
+        if (0xFF != semitone) {
+            semitone++;
+        }
+        tune->pos++;
+    }
+    if ('.' == rtttl_peek(tune)) {
+        dotted = 1;
+        tune->pos++;
+    }
+    octave = rtttl_number(tune);
+    if ((RTTTL_MIN_OCTAVE > octave) || (RTTTL_MAX_OCTAVE < octave)) {
+        octave = tune->octave;
+    }
+    if ('.' == rtttl_peek(tune)) {
+        dotted = 1;
+        tune->pos++;
+    }
+
+    // Anything left up to the separator is ignored
+    while ((c = rtttl_peek(tune)) && (',' != c)) {
+        tune->pos++;
+    }
+    if (c) {
+        tune->pos++;
+    }
+
+    *ms = tune->whole_ms / duration;
+    if (dotted) {
+        *ms += *ms / 2;
+    }
+    if (0 == *ms) {
+        *ms = 1;
+    }
+
+    // Unknown letters play as pauses, b# is c of the next octave
+    if (0xFF == semitone) {
+        *top = 0;
+        return 1;
+    }
+    if (12 == semitone) {
+        semitone = 0;
+        if (RTTTL_MAX_OCTAVE > octave) {
+            octave++;
+        }
+    }
+    *top = pgm_read_word(&g_octave4_top[semitone]);
+    if (4 <= octave) {
+        *top >>= octave - 4;
+    }
+    else {
+        *top <<= 4 - octave;
+    }
+    return 1;
+}
+
+/*
+ * Start decoding from the first note again.
+ *
+ * @param rtttl_t *tune decoder state
+ * @returns void
+ */
+void rtttl_rewind(rtttl_t *tune) { tune->pos = tune->first; }
+
+/*
+ EOF
+ */
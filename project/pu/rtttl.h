@@ -0,0 +1,58 @@
+#ifndef _RTTTL_H
+#define _RTTTL_H
+
+#include <stdint.h>
+
+/*
+ * Streaming decoder for RTTTL ringtones, e.g.
+ *
+ *   siren:d=8,o=5,b=160:a,e,a,e,p,4a6,4e6
+ *
+ * The tune is read one byte at a time through a reader function, so it can
+ * live in PROGMEM or EEPROM and the decoder uses the same few bytes of RAM
+ * for any tune length. The tune ends at NUL or erased EEPROM (0xFF).
+ */
+
+// Byte reader, pgm_read_byte / eeprom_read_byte or plain dereference
+typedef uint8_t (*rtttl_reader_t)(const char *addr);
+
+typedef struct {
+    rtttl_reader_t read;
+    const char *first; // first note after the header
+    const char *pos;   // next byte to decode
+    uint16_t whole_ms; // duration of a whole note
+    uint8_t duration;  // default duration
+    uint8_t octave;    // default octave
+} rtttl_t;
+
+/*
+ * Parse the name and the d, o, b defaults of a tune.
+ *
+ * @param rtttl_t *tune decoder state to initialize
+ * @param const char *src address of the tune
+ * @param rtttl_reader_t read function reading one byte of src
+ *
+ * @returns uint8_t 0 for success, 1 if there is no tune at src
+ */
+uint8_t rtttl_open(rtttl_t *tune, const char *src, rtttl_reader_t read);
+
+/*
+ * Decode the next note.
+ *
+ * @param rtttl_t *tune decoder state
+ * @param uint16_t *top timer 1 TOP value, 0 for a pause
+ * @param uint16_t *ms duration in milliseconds
+ *
+ * @returns uint8_t 1 if a note was decoded, 0 at the end of the tune
+ */
+uint8_t rtttl_next(rtttl_t *tune, uint16_t *top, uint16_t *ms);
+
+/*
+ * Start decoding from the first note again.
+ *
+ * @param rtttl_t *tune decoder state
+ * @returns void
+ */
+void rtttl_rewind(rtttl_t *tune);
+
+#endif // _RTTTL_H
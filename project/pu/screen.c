@@ -0,0 +1,219 @@
+#include "screen.h"
+
+#include "hal.h"
+#include "lcd.h"
+
+// Slot marker in templates
+#define SCREEN_SLOT '%'
+
+typedef struct {
+    const char *line[LCD_LINES];
+} screen_t;
+
+// Line templates
+static const char g_empty[] PROGMEM = "";
+static const char g_welcome[] PROGMEM = "Welcome!";
+static const char g_status[] PROGMEM = "Status:";
+static const char g_movement[] PROGMEM = "Movement!";
+static const char g_countdown[] PROGMEM = "Movement!   %0s";
+static const char g_correct[] PROGMEM = "Correct Password";
+static const char g_wrong[] PROGMEM = "Wrong Password:";
+static const char g_param[] PROGMEM = "%0";
+static const char g_time_up[] PROGMEM = "TIME IS UP!";
+static const char g_armed[] PROGMEM = "Armed";
+static const char g_error[] PROGMEM = "Error:";
+static const char g_error_code[] PROGMEM = "Code %0";
+static const char g_user[] PROGMEM = "User %0";
+
+// Screens by ID, 0 is blank
+static const screen_t g_screens[SCREEN_COUNT] PROGMEM = {
+    [0] = {{g_empty, g_empty}},
+    [SCREEN_WELCOME] = {{g_welcome, g_empty}},
+    [SCREEN_MOVEMENT] = {{g_movement, g_empty}},
+    [SCREEN_COUNTDOWN] = {{g_countdown, g_empty}},
+    [SCREEN_CORRECT] = {{g_correct, g_param}},
+    [SCREEN_WRONG] = {{g_wrong, g_param}},
+    [SCREEN_TIME_UP] = {{g_status, g_time_up}},
+    [SCREEN_ARMED] = {{g_status, g_armed}},
+    [SCREEN_ERROR] = {{g_error, g_error_code}},
+    [SCREEN_USER] = {{g_welcome, g_user}},
+    [SCREEN_KEYS] = {{g_empty, g_empty}},
+};
+
+/*
+ * Draw a number without leading zeros, at least width characters wide.
+ */
+static void screen_draw_number(uint8_t value, uint8_t width)
+{
+    char digits[3];
+    uint8_t count = 0;
+
+    do {
+        digits[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    while (width > count) {
+        lcd_fb_putc(' ');
+        width--;
+    }
+    while (count) {
+        lcd_fb_putc(digits[--count]);
+    }
+}
+
+/*
+ * Draw one parameter formatted by its type.
+ */
+static void screen_draw_param(const uint8_t *param)
+{
+    uint8_t count;
+    uint8_t digit;
+
+    switch (param[0]) {
+    case PARAM_DIGITS:
+        // Packed BCD, high nibble first
+        count = param[1];
+        for (uint8_t idx = 0; count > idx; idx++) {
+            digit = param[2 + (idx >> 1)];
+            digit = (idx & 1) ? (digit & 0x0F) : (digit >> 4);
+            lcd_fb_putc((9 >= digit) ? '0' + digit : '?');
+        }
+        break;
+    case PARAM_SECONDS:
+        screen_draw_number(param[1], 2);
+        break;
+    case PARAM_USER:
+    case PARAM_ERROR:
+        screen_draw_number(param[1], 1);
+        break;
+    case PARAM_KEYS:
+        // Masked, one '*' per key
+        for (count = param[1]; count; count--) {
+            lcd_fb_putc('*');
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Draw one line template, expanding parameter slots.
+ */
+static void screen_draw_line(const char *template, const uint8_t *params,
+                             uint8_t len)
+{
+    const uint8_t *param;
+    char c;
+    uint8_t slot;
+
+    while ((c = pgm_read_byte(template++))) {
+        if (SCREEN_SLOT != c) {
+            lcd_fb_putc(c);
+            continue;
+        }
+
+        c = pgm_read_byte(template++);
+        if (SCREEN_SLOT == c) {
+            lcd_fb_putc(c);
+            continue;
+        }
+        // Broken template, stop at the end of the string
+        if (!c) {
+            return;
+        }
+        slot = c - '0';
+        if (SCREEN_PARAMS <= slot) {
+            continue;
+        }
+
+        // Missing parameters leave the slot empty
+        param = screen_param(params, len, slot);
+        if (param) {
+            screen_draw_param(param);
+        }
+    }
+}
+
+/*
+ * Size of the parameter at params in bytes, 0 if it is cut off or of an
+ * unknown type.
+ */
+static uint8_t screen_param_size(const uint8_t *params, uint8_t len)
+{
+    uint8_t size = 2;
+
+    if (2 > len) {
+        return 0;
+    }
+    switch (params[0]) {
+    case PARAM_DIGITS:
+        if (PARAM_DIGITS_MAX < params[1]) {
+            return 0;
+        }
+        size += (params[1] + 1) >> 1;
+        break;
+    case PARAM_SECONDS:
+    case PARAM_USER:
+    case PARAM_ERROR:
+    case PARAM_KEYS:
+        break;
+    default:
+        return 0;
+    }
+    return (size <= len) ? size : 0;
+}
+
+/*
+ * Find a parameter of a frame.
+ *
+ * @param const uint8_t *params typed parameters of the frame after the ID
+ * @param uint8_t len length of params
+ * @param uint8_t index parameter to find, 0 for the first
+ *
+ * @returns const uint8_t* the type byte of the parameter, its value follows.
+ * 0 if the frame has fewer parameters or is malformed before it.
+ */
+const uint8_t *screen_param(const uint8_t *params, uint8_t len,
+                            uint8_t index)
+{
+    uint8_t size;
+
+    while (0 != (size = screen_param_size(params, len))) {
+        if (0 == index) {
+            return params;
+        }
+        index--;
+        params += size;
+        len -= size;
+    }
+    return 0;
+}
+
+/*
+ * Draw a screen into the LCD framebuffer, lcd_flush() shows it.
+ *
+ * @param uint8_t id SCREEN_* ID
+ * @param const uint8_t *params typed parameters of the frame after the ID
+ * @param uint8_t len length of params, 0 if the screen has no slots
+ *
+ * @returns uint8_t 0 for success, 1 for an unknown ID
+ */
+uint8_t screen_draw(uint8_t id, const uint8_t *params, uint8_t len)
+{
+    if (SCREEN_COUNT <= id) {
+        return 1;
+    }
+
+    lcd_fb_clear();
+    for (uint8_t y = 0; LCD_LINES > y; y++) {
+        lcd_fb_gotoxy(0, y);
+        screen_draw_line(pgm_read_ptr(&g_screens[id].line[y]), params, len);
+    }
+    return 0;
+}
+
+/*
+ EOF
+ */
@@ -0,0 +1,45 @@
+#ifndef _SCREEN_H
+#define _SCREEN_H
+
+#include <stdint.h>
+
+#include "protocol.h"
+
+/*
+ * Screen table for all text shown on the LCD. Each screen is one template
+ * per line, templates and the table live in flash so screens cost no RAM.
+ * Screen IDs are the ones of the display protocol, see protocol.h.
+ *
+ * A template may contain parameter slots, '%' followed by the parameter
+ * index '0' - '3', replaced by that parameter of the frame formatted by its
+ * type. "%%" draws a single '%'.
+ */
+
+// Parameter slots per screen
+#define SCREEN_PARAMS 4
+
+/*
+ * Draw a screen into the LCD framebuffer, lcd_flush() shows it.
+ *
+ * @param uint8_t id SCREEN_* ID
+ * @param const uint8_t *params typed parameters of the frame after the ID
+ * @param uint8_t len length of params, 0 if the screen has no slots
+ *
+ * @returns uint8_t 0 for success, 1 for an unknown ID
+ */
+uint8_t screen_draw(uint8_t id, const uint8_t *params, uint8_t len);
+
+/*
+ * Find a parameter of a frame.
+ *
+ * @param const uint8_t *params typed parameters of the frame after the ID
+ * @param uint8_t len length of params
+ * @param uint8_t index parameter to find, 0 for the first
+ *
+ * @returns const uint8_t* the type byte of the parameter, its value follows.
+ * 0 if the frame has fewer parameters or is malformed before it.
+ */
+const uint8_t *screen_param(const uint8_t *params, uint8_t len,
+                            uint8_t index);
+
+#endif // _SCREEN_H
@@ -25,8 +25,8 @@ void timer1_init_mode_9()
     TCCR1A |= (1 << WGM10);
     TCCR1B |= (1 << WGM13);
 
-    // Enable output compare A match interrupt
-    TIMSK1 |= (1 << OCIE1A);
+    // OCR1A is double buffered and updated at BOTTOM, so TOP can be changed
+    // on the fly without glitches and no interrupt is needed.
     TCNT1 = 0;
 }
 
@@ -86,6 +86,23 @@ void timer1_set_prescaler(const uint16_t prescaler)
  */
 void timer1_set_target(uint16_t value) { OCR1A = value; }
 
+/*
+ * Connect or disconnect OC1A (buzzer) from the timer, a disconnected pin
+ * stays at its PORTB value so the timer can keep running during rests.
+ *
+ * @param uint8_t 1 to toggle OC1A on compare match, 0 to disconnect.
+ * @returns Void
+ */
+void timer1_set_output(uint8_t enable)
+{
+    if (enable) {
+        TCCR1A |= (1 << COM1A0);
+    }
+    else {
+        TCCR1A &= ~(1 << COM1A0);
+    }
+}
+
 /*
  EOF
  */
@@ -8,6 +8,20 @@
 #define PS_256 256
 #define PS_1024 1024
 
+/*
+ * In mode 9 the counter runs up to TOP and back down and OC1A toggles once
+ * per round trip, so the output frequency is F_CPU / (4 * N * TOP). Notes are
+ * converted to TOP values at compile time, rounded to nearest:
+ *
+ * TOP = F_CPU / (4 * N_prescaler * note_frequency)
+ *
+ * With prescaler 8 every note in notes.h (31 Hz - 4978 Hz) fits 16 bits.
+ */
+#define TIMER1_NOTE_PS PS_8
+#define TIMER1_NOTE_TOP(hz)                                                    \
+    ((uint16_t)((F_CPU + (2UL * TIMER1_NOTE_PS * (hz))) /                      \
+                (4UL * TIMER1_NOTE_PS * (hz))))
+
 #include <stdint.h>
 
 /*
@@ -43,4 +57,13 @@ void timer1_set_target(uint16_t value);
  */
 void timer1_set_prescaler(uint16_t prescaler);
 
+/*
+ * Connect or disconnect OC1A (buzzer) from the timer, a disconnected pin
+ * stays at its PORTB value so the timer can keep running during rests.
+ *
+ * @param uint8_t 1 to toggle OC1A on compare match, 0 to disconnect.
+ * @returns Void
+ */
+void timer1_set_output(uint8_t enable);
+
 #endif // _TIMER1_H
@@ -0,0 +1,53 @@
+#include "timer2.h"
+
+// Libs
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/*
+ * Initialize UNO timer 2 to mode 2 (CTC) interrupting every millisecond.
+ * ISR(TIMER2_COMPA_vect) is provided by the user of the tick.
+ *
+ * @param None
+ * @returns Void
+ */
+void timer2_init_ctc_ms()
+{
+    // Timer 2 is shut down while unused, see power.c
+    PRR &= ~(1 << PRTIM2);
+
+    // Clear registers
+    timer2_clear();
+
+    // UNO doc page 155 table 18-8, CTC, TOP OCR2A
+    TCCR2A |= (1 << WGM21);
+
+    OCR2A = MILLISECOND_64;
+
+    // Enable output compare A match interrupt
+    TIMSK2 |= (1 << OCIE2A);
+
+    // Prescaler 64: UNO doc page 156 table 18-9
+    TCCR2B |= TIMER2_PS_64;
+
+    // Enables interrupts
+    sei();
+}
+
+/*
+ * Clear UNO timer 2 registers
+ *
+ * @param None
+ * @returns void
+ */
+void timer2_clear()
+{
+    TCCR2A = 0;
+    TCCR2B = 0;
+    TCNT2 = 0;
+    TIMSK2 = 0;
+}
+
+/*
+ EOF
+ */
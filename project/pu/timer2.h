@@ -0,0 +1,27 @@
+#ifndef _TIMER2_H
+#define _TIMER2_H
+
+// TOP = F_CPU / (prescaler * frequency) - 1, 1 kHz tick with prescaler 64
+#define TIMER2_PS_64 0b00000100
+#define MILLISECOND_64 249
+
+#include <stdint.h>
+
+/*
+ * Initialize UNO timer 2 to mode 2 (CTC) interrupting every millisecond.
+ * ISR(TIMER2_COMPA_vect) is provided by the user of the tick.
+ *
+ * @param None
+ * @returns Void
+ */
+void timer2_init_ctc_ms();
+
+/*
+ * Clear UNO timer 2 registers
+ *
+ * @param None
+ * @returns void
+ */
+void timer2_clear();
+
+#endif // _TIMER2_H